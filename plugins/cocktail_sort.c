@@ -0,0 +1,35 @@
+// Example plugin: cocktail shaker sort, a bubble sort that alternates direction on every pass.
+// Build with "make plugins", then start xsort from the repository root to get a new radio button.
+#include <stdbool.h>
+
+#include "xsort_plugin.h"
+
+static void cocktail_sort(const struct xsort_plugin_api *api, int64_t len) {
+    int64_t start = 0;
+    int64_t end = len - 1;
+    bool swapped = true;
+    while(swapped && start < end) {
+        swapped = false;
+        for(int64_t x = start; x < end; x++) {
+            if(api->smaller(api->ctx, x + 1, x)) {
+                api->swap(api->ctx, x, x + 1);
+                swapped = true;
+            }
+        }
+        end--;
+        for(int64_t x = end; x > start; x--) {
+            if(api->smaller(api->ctx, x, x - 1)) {
+                api->swap(api->ctx, x, x - 1);
+                swapped = true;
+            }
+        }
+        start++;
+    }
+}
+
+const struct xsort_plugin xsort_plugin_descriptor = {
+    .abi_version = XSORT_PLUGIN_ABI_VERSION,
+    .name = "Cocktail Sort (plugin)",
+    .sort = cocktail_sort,
+    .flags = XSORT_CAP_QUADRATIC,
+};
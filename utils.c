@@ -1,14 +1,18 @@
 #define _DEFAULT_SOURCE
 #include <errno.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
 #include <unistd.h>
 #include <libgen.h>
 
 #include "utils.h"
 
+uint64_t ipc_bytes_read, ipc_bytes_written;
+
 void pipe_(int *pipefds) {
     while(pipe(pipefds) != 0) {
         if(errno == EINTR) continue;
@@ -25,9 +29,9 @@ void close_(int fd) {
     }
 }
 
-void write_(int fd, char *buf, int len) {
+void write_(int fd, char *buf, size_t len) {
     while(len > 0) {
-        int bytes = write(fd, buf, len);
+        ssize_t bytes = write(fd, buf, len);
         if(bytes < 0) {
             if(errno == EINTR) continue;
             perror("write");
@@ -35,12 +39,13 @@ void write_(int fd, char *buf, int len) {
         }
         len -= bytes;
         buf += bytes;
+        ipc_bytes_written += bytes;
     }
 }
 
-void read_(int fd, char *buf, int len) {
+void read_(int fd, char *buf, size_t len) {
     while(len > 0) {
-        int bytes = read(fd, buf, len);
+        ssize_t bytes = read(fd, buf, len);
         if(bytes < 0) {
             if(errno == EOF) continue;
             perror("read");
@@ -52,6 +57,7 @@ void read_(int fd, char *buf, int len) {
         }
         len -= bytes;
         buf += bytes;
+        ipc_bytes_read += bytes;
     }
 }
 
@@ -69,6 +75,129 @@ int read_int(int fd) {
     return data;
 }
 
+void write_int64(int fd, int64_t data) {
+    char buf[sizeof(int64_t)];
+    memcpy(buf, &data, sizeof(int64_t));
+    write_(fd, buf, sizeof(int64_t));
+}
+
+int64_t read_int64(int fd) {
+    char buf[sizeof(int64_t)];
+    int64_t data;
+    read_(fd, buf, sizeof(int64_t));
+    memcpy(&data, buf, sizeof(int64_t));
+    return data;
+}
+
+// zigzag maps small negative numbers to small codes: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+// codes below VARINT_ONE_BYTE are a single byte, larger ones are the byte VARINT_ONE_BYTE - 1 + n
+// followed by the n low bytes of the code, little endian
+#define VARINT_ONE_BYTE 0xf8
+
+int varint_encode(char *buf, int64_t data) {
+    uint64_t code = ((uint64_t)data << 1) ^ (uint64_t)(data >> 63);
+    if(code < VARINT_ONE_BYTE) {
+        buf[0] = (char)code;
+        return 1;
+    }
+    int n = 0;
+    while(code) {
+        buf[++n] = (char)(code & 0xff);
+        code >>= 8;
+    }
+    buf[0] = (char)(VARINT_ONE_BYTE - 1 + n);
+    return n + 1;
+}
+
+static int64_t varint_code(uint64_t code) {
+    return (int64_t)(code >> 1) ^ -(int64_t)(code & 1);
+}
+
+int varint_decode(const char *buf, int64_t *data) {
+    unsigned char first = buf[0];
+    if(first < VARINT_ONE_BYTE) {
+        *data = varint_code(first);
+        return 1;
+    }
+    int n = first - (VARINT_ONE_BYTE - 1);
+    uint64_t code = 0;
+    for(int b = n; b > 0; b--) {
+        code = code << 8 | (unsigned char)buf[b];
+    }
+    *data = varint_code(code);
+    return n + 1;
+}
+
+void write_varint(int fd, int64_t data) {
+    char buf[VARINT_MAX];
+    write_(fd, buf, varint_encode(buf, data));
+}
+
+int64_t read_varint(int fd) {
+    char buf[VARINT_MAX];
+    read_(fd, buf, 1);
+    if((unsigned char)buf[0] >= VARINT_ONE_BYTE) {
+        read_(fd, buf + 1, (unsigned char)buf[0] - (VARINT_ONE_BYTE - 1));
+    }
+    int64_t data;
+    varint_decode(buf, &data);
+    return data;
+}
+
+time_t get_time_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t get_time_nsec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void *malloc_(size_t size) {
+    void *ptr = malloc(size);
+    if(!ptr) {
+        perror("malloc");
+        exit(1);
+    }
+    return ptr;
+}
+
+int64_t *load_numbers(const char *path, int64_t *len) {
+    *len = 0;
+    FILE *file = fopen(path, "r");
+    if(!file) {
+        perror(path);
+        return NULL;
+    }
+    int64_t *buf = NULL;
+    int64_t cap = 0;
+    int64_t num;
+    while(fscanf(file, "%" SCNd64, &num) == 1) {
+        if(*len == cap) {
+            cap = cap ? cap * 2 : 64;
+            int64_t *buf_ = reallocarray(buf, cap, sizeof(int64_t));
+            if(!buf_) {
+                perror("reallocarray");
+                exit(1);
+            }
+            buf = buf_;
+        }
+        buf[(*len)++] = num;
+    }
+    bool ok = feof(file);
+    fclose(file);
+    if(!ok) {
+        fprintf(stderr, "%s: not a list of numbers\n", path);
+        free(buf);
+        *len = 0;
+        return NULL;
+    }
+    return buf;
+}
+
 int i_min(int a, int b) {
     return a < b ? a : b;
 }
@@ -77,6 +206,14 @@ int i_max(int a, int b) {
     return a > b ? a : b;
 }
 
+int64_t i64_min(int64_t a, int64_t b) {
+    return a < b ? a : b;
+}
+
+int64_t i64_max(int64_t a, int64_t b) {
+    return a > b ? a : b;
+}
+
 static char *instance_name = "";
 
 void set_instance_name(int argc, char **argv) {
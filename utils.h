@@ -1,10 +1,35 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// bytes moved by read_ and write_ in this process, for the resource accounting
+extern uint64_t ipc_bytes_read, ipc_bytes_written;
+
 void pipe_(int *pipefds);
 void close_(int fd);
-void write_(int fd, char *buf, int bytes);
-void read_(int fd, char *buf, int bytes);
+void write_(int fd, char *buf, size_t bytes);
+void read_(int fd, char *buf, size_t bytes);
 void write_int(int fd, int data);
 int read_int(int fd);
+void write_int64(int fd, int64_t data);
+int64_t read_int64(int fd);
+// variable length integers for indices and lengths, values in -124..123 take one byte
+#define VARINT_MAX 9
+// both return the number of bytes, at most VARINT_MAX
+int varint_encode(char *buf, int64_t data);
+int varint_decode(const char *buf, int64_t *data);
+void write_varint(int fd, int64_t data);
+int64_t read_varint(int fd);
+// wall clock, comparable between processes
+time_t get_time_usec(void);
+// monotonic, for measuring durations
+int64_t get_time_nsec(void);
+void *malloc_(size_t size);
+// reads whitespace separated numbers, NULL with *len = 0 when the file is missing, empty or holds anything else
+int64_t *load_numbers(const char *path, int64_t *len);
 int i_min(int a, int b);
 int i_max(int a, int b);
+int64_t i64_min(int64_t a, int64_t b);
+int64_t i64_max(int64_t a, int64_t b);
 void set_instance_name(int argc, char **argv);
 char *get_instance_name(void);
@@ -21,6 +21,12 @@
 
 #include "utils.h"
 #include "xsort_subproc.h"
+#include "xsort_bench.h"
+#include "xsort_tuning.h"
+#include "xsort_external.h"
+#include "xsort_socket.h"
+#include "xsort_export.h"
+#include "xsort_fork_server.h"
 
 static void drawButton(const char *text, int x, int y, Display *display, Window window, GC borderGC, GC fillGC, GC textGC, XFontStruct *font, int *width, int *height) {
     *width = XTextWidth(font, text, strlen(text)) + 10;
@@ -43,7 +49,7 @@ static void drawRadioButton(const char *text, int x, int y, Display *display, Wi
 }
 
 struct Button {
-    enum ButtonType { LOAD, SAVE, LAUNCH, UP, DOWN, INSERT, DELETE, RANDOM, ALGO_SELECT } type;
+    enum ButtonType { LOAD, SAVE, LAUNCH, UP, DOWN, INSERT, DELETE, RANDOM, TYPE, PRIORITY, CANCEL_ALL, ALGO_SELECT } type;
     int x, y;
     int width, height;
 };
@@ -56,11 +62,15 @@ static const char * const buttonText[] = {
     [DOWN] = "Down",
     [INSERT] = "Insert",
     [DELETE] = "Delete",
-    [RANDOM] = "Random"
+    [RANDOM] = "Random",
+    // the label shows the selected element type, see the drawing code
+    [TYPE] = "Type",
+    [PRIORITY] = "Priority",
+    [CANCEL_ALL] = "Cancel all"
 };
 
-static void insertAt(int64_t **buf, int *bufLen, int bufSelection, int64_t inputNr) {
-    if(*bufLen == INT_MAX) {
+static void insertAt(int64_t **buf, int64_t *bufLen, int64_t bufSelection, int64_t inputNr) {
+    if(*bufLen == INT64_MAX) {
         fprintf(stderr, "Buffer size too large\n");
         return;
     }
@@ -69,18 +79,18 @@ static void insertAt(int64_t **buf, int *bufLen, int bufSelection, int64_t input
         perror("reallocarray");
         exit(1);
     }
-    for(int i = *bufLen; i > bufSelection; i--) {
+    for(int64_t i = *bufLen; i > bufSelection; i--) {
         (*buf)[i] = (*buf)[i - 1];
     }
     (*buf)[bufSelection] = inputNr;
     (*bufLen)++;
 }
 
-static void deleteAt(int64_t **buf, int *bufLen, int bufSelection) {
+static void deleteAt(int64_t **buf, int64_t *bufLen, int64_t bufSelection) {
     if(*bufLen == 0) {
         return;
     }
-    for(int i = bufSelection; i < *bufLen - 1; i++) {
+    for(int64_t i = bufSelection; i < *bufLen - 1; i++) {
         (*buf)[i] = (*buf)[i + 1];
     }
     (*bufLen)--;
@@ -92,13 +102,13 @@ static void deleteAt(int64_t **buf, int *bufLen, int bufSelection) {
 }
 
 static const char * const buf_file_name = "xsort_buf.txt";
-static void saveBuffer(int64_t *buf, int bufLen) {
+static void saveBuffer(int64_t *buf, int64_t bufLen) {
     FILE *file = fopen(buf_file_name, "w");
     if(!file) {
         perror("fopen");
         return;
     }
-    for(int i = 0; i < bufLen; i++) {
+    for(int64_t i = 0; i < bufLen; i++) {
         if(fprintf(file, "%" PRId64 "\n", buf[i]) < 0) {
             perror("fprintf");
             fclose(file);
@@ -111,116 +121,43 @@ static void saveBuffer(int64_t *buf, int bufLen) {
     }
 }
 
-static int64_t *loadBuffer(int *bufLen) {
-    FILE *file = fopen(buf_file_name, "r");
-    int64_t *buf = NULL;
-    size_t len = 0;
-
-    if(!file) {
-        perror("fopen");
-        goto fail;
-    }
-
-    while(1) {
-        int64_t num;
-        if(fscanf(file, "%" SCNd64 "\n", &num) != 1) {
-            if(feof(file)) {
-                break;
-            }
-            perror("fscanf");
-            goto fail2;
-        }
-        if(len == 0 || ((len & (len - 1)) == 0)) {
-            // realloc when len is 0 or a power of 2
-            int size_t_bits = sizeof(size_t) * 8;
-            if(len & (((size_t)1) << (size_t_bits - 1))) {
-                fprintf(stderr, "Buffer size too large\n");
-                goto fail2;
-            }
-            int64_t *buf_ = reallocarray(buf, len == 0 ? 1 : len << 1, sizeof(int64_t));
-            if(!buf_) {
-                perror("reallocarray");
-                goto fail2;
-            }
-            buf = buf_;
-        }
-        buf[len++] = num;
-    }
-    if(fclose(file) != 0) {
-        perror("fclose");
-    }
-    *bufLen = len;
-    return buf;
+static bool in_bounds(int x, int y, struct Button *btn) {
+    return x >= btn->x && x <= (btn->x + btn->width) && y >= btn->y && y <= (btn->y + btn->height);
+}
 
-    fail2:
-    if(fclose(file) != 0) {
-        perror("fclose");
+int main(int argc, char **argv) {
+    set_instance_name(argc, argv);
+    algo_load_plugins();
+    tuning_load();
+    if(argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return bench_main(argc - 1, argv + 1);
     }
-    fail:
-    if(buf) {
-        free(buf);
+    if(argc > 1 && strcmp(argv[1], "--tune") == 0) {
+        return tune_main(argc - 1, argv + 1);
     }
-    *bufLen = 0;
-    return NULL;
-}
-
-static void spawn_sort(char *buf, int bufLen, int algoSelection) {
-    pid_t sort_pid = fork();
-    if(sort_pid < 0) {
-        perror("fork");
+    if(argc > 1 && strcmp(argv[1], "--external") == 0) {
+        return external_main(argc - 1, argv + 1);
     }
-    if(sort_pid == 0) {
-        run_sort((int64_t*)buf, bufLen, algoSelection);
-        exit(0);
+    if(argc > 1 && strcmp(argv[1], "--stream") == 0) {
+        return stream_main(argc - 1, argv + 1);
     }
-}
-
-static int launch_fork_server(void) {
-    int fork_server_fd[2];
-    pipe_(fork_server_fd);
-    pid_t fork_server_pid = fork();
-    if(fork_server_pid < 0) {
-        perror("fork");
-        exit(1);
+    if(argc > 1 && strcmp(argv[1], "--listen") == 0) {
+        return listen_main(argc - 1, argv + 1);
     }
-    if(fork_server_pid != 0) {
-        close_(fork_server_fd[0]);
-        return fork_server_fd[1];
+    if(argc > 1 && strcmp(argv[1], "--export") == 0) {
+        return export_main(argc - 1, argv + 1);
     }
-    close_(fork_server_fd[1]);
-    char *buf = NULL;
-    while(1) {
-        int algoSelection = read_int(fork_server_fd[0]);
-        if(algoSelection == -1) {
-            close_(fork_server_fd[0]);
-            if(buf) free(buf);
-            exit(0);
-        }
-        int bufLen = read_int(fork_server_fd[0]);
-        buf = reallocarray(buf, bufLen, sizeof(int64_t));
-        if(!buf) {
-            perror("reallocarray");
-            exit(1);
-        }
-        read_(fork_server_fd[0], buf, bufLen * sizeof(int64_t));
-        if(algoSelection != ALGO_LEN - 1) {
-            spawn_sort(buf, bufLen, algoSelection);
-        } else {
-            for(int i = 0; i < ALGO_LEN - 1; i++) {
-                spawn_sort(buf, bufLen, i);
-            }
+    // usage: xsort [--jobs N], N renderers animate at once, one per core by default
+    int maxJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if(argc > 2 && strcmp(argv[1], "--jobs") == 0) {
+        maxJobs = atoi(argv[2]);
+        if(maxJobs < 1) {
+            fprintf(stderr, "Invalid job limit \"%s\"\n", argv[2]);
+            return 1;
         }
     }
-}
-
-static bool in_bounds(int x, int y, struct Button *btn) {
-    return x >= btn->x && x <= (btn->x + btn->width) && y >= btn->y && y <= (btn->y + btn->height);
-}
-
-int main(int argc, char **argv) {
-    set_instance_name(argc, argv);
     signal(SIGCHLD, SIG_IGN);
-    int fork_server_fd = launch_fork_server();
+    int fork_server_fd = launch_fork_server(maxJobs);
 
     struct Button buttons[] = {
         (struct Button){.type = LOAD, .x = 10},
@@ -230,10 +167,18 @@ int main(int argc, char **argv) {
         (struct Button){.type = DOWN},
         (struct Button){.type = INSERT},
         (struct Button){.type = DELETE},
-        (struct Button){.type = RANDOM}
+        (struct Button){.type = RANDOM},
+        (struct Button){.type = TYPE},
+        (struct Button){.type = PRIORITY},
+        (struct Button){.type = CANCEL_ALL}
     };
     const int buttonsLen = sizeof(buttons) / sizeof(buttons[0]);
-    struct Button selectAlgoButtons[ALGO_LEN];
+    const int algoLen = algo_count();
+    struct Button *selectAlgoButtons = calloc(algoLen, sizeof(struct Button));
+    if(!selectAlgoButtons) {
+        perror("calloc");
+        exit(1);
+    }
 
     Display *display = XOpenDisplay(NULL);
     if(!display) {
@@ -329,9 +274,11 @@ int main(int argc, char **argv) {
         exit(1);
     }
     buf[0] = 0;
-    int bufLen = 1;
-    int bufSelection = 0;
+    int64_t bufLen = 1;
+    int64_t bufSelection = 0;
     int algoSelection = 0;
+    int elemType = ELEM_INT64_TYPE;
+    enum job_priority priority = PRIORITY_NORMAL;
 
     for(;;) {
         bool changed = false;
@@ -391,7 +338,7 @@ int main(int argc, char **argv) {
                     break;
                 }
             }
-            for(int i = 0;i < ALGO_LEN; i++) {
+            for(int i = 0;i < algoLen; i++) {
                 if(in_bounds(x, y, &selectAlgoButtons[i])) {
                     type = ALGO_SELECT;
                     algoSelection = i;
@@ -410,7 +357,7 @@ int main(int argc, char **argv) {
                 case LOAD:
                     fprintf(stderr, "Loading from %s\n", buf_file_name);
                     free(buf);
-                    buf = loadBuffer(&bufLen);
+                    buf = load_numbers(buf_file_name, &bufLen);
                     if(bufSelection > bufLen) {
                         bufSelection = bufLen;
                     }
@@ -424,15 +371,16 @@ int main(int argc, char **argv) {
                         fprintf(stderr, "Buffer is empty\n");
                         break;
                     }
-                    write_int(fork_server_fd, algoSelection);
-                    write_int(fork_server_fd, bufLen);
-                    write_(fork_server_fd, (char*)buf, bufLen * sizeof(int64_t));
+                    // the partial sorts take k from the input field
+                    write_request(fork_server_fd, &(struct sort_request){
+                        .algoSelection = algoSelection, .k = inputNr, .elemType = elemType, .priority = priority,
+                        .launchUsec = get_time_usec(), .bufLen = bufLen, .buf = buf });
                     break;
                 case UP:
-                    bufSelection = i_max(0, bufSelection - 1);
+                    bufSelection = i64_max(0, bufSelection - 1);
                     break;
                 case DOWN:
-                    bufSelection = i_min(bufSelection + 1, bufLen);
+                    bufSelection = i64_min(bufSelection + 1, bufLen);
                     break;
                 case INSERT:
                     insertAt(&buf, &bufLen, bufSelection, inputNr);
@@ -441,7 +389,7 @@ int main(int argc, char **argv) {
                     break;
                 case DELETE:
                     if(bufSelection == bufLen) {
-                        fprintf(stderr, "Nothing to delete at %d\n", bufSelection);
+                        fprintf(stderr, "Nothing to delete at %" PRId64 "\n", bufSelection);
                         break;
                     }
                     deleteAt(&buf, &bufLen, bufSelection);
@@ -453,10 +401,20 @@ int main(int argc, char **argv) {
                         perror("getrandom");
                         break;
                     }
-                    for(int i = 0; i < bufLen; i++) {
+                    for(int64_t i = 0; i < bufLen; i++) {
                         buf[i] %= 100;
                     }
                     break;
+                case TYPE:
+                    elemType = (elemType + 1) % ELEM_TYPES_LEN;
+                    break;
+                case PRIORITY:
+                    priority = (priority + 1) % PRIORITIES_LEN;
+                    break;
+                case CANCEL_ALL:
+                    // running windows close, queued launches are dropped
+                    write_request(fork_server_fd, &(struct sort_request){ .algoSelection = REQUEST_CANCEL_ALL });
+                    break;
             }
         }
         if(changed || e.type == Expose) {
@@ -464,7 +422,16 @@ int main(int argc, char **argv) {
             int y = 10;
             for (int i = 0; i < buttonsLen; i++) {
                 buttons[i].y = y;
-                drawButton(buttonText[buttons[i].type], buttons[i].x, buttons[i].y, display, window, borderGC, fillGC, textGC, font, &buttons[i].width, &buttons[i].height);
+                char typeText[64];
+                const char *text = buttonText[buttons[i].type];
+                if(buttons[i].type == TYPE) {
+                    snprintf(typeText, sizeof(typeText), "Type: %s", elem_types[elemType].name);
+                    text = typeText;
+                } else if(buttons[i].type == PRIORITY) {
+                    snprintf(typeText, sizeof(typeText), "Priority: %s", priority_names[priority]);
+                    text = typeText;
+                }
+                drawButton(text, buttons[i].x, buttons[i].y, display, window, borderGC, fillGC, textGC, font, &buttons[i].width, &buttons[i].height);
                 if(i != buttonsLen - 1) {
                     buttons[i + 1].x = buttons[i].x + buttons[i].width + 10;
                 }
@@ -476,20 +443,25 @@ int main(int argc, char **argv) {
             char textBuf[255];
             sprintf(textBuf, "%" PRId64, inputNr);
             XDrawString(display, window, textGC, 15, y + textAreaHeight / 2 + 5, textBuf, strlen(textBuf));
+            struct sort_goal goal = algo_goal(algoSelection, bufLen, inputNr);
+            if(goal.kind != GOAL_FULL && bufLen > 0) {
+                sprintf(textBuf, "k = %" PRId64 " (taken from the input field)", goal.k);
+                XDrawString(display, window, textGC, 400, y + textAreaHeight / 2 + 5, textBuf, strlen(textBuf));
+            }
             XFlush(display);
             y = buttons[0].y + buttons[0].height + 10 + textAreaHeight + 20;
-            sprintf(textBuf, "Edit buffer contains %d number%s to be sorted", bufLen, bufLen == 1 ? "" : "s");
+            sprintf(textBuf, "Edit buffer contains %" PRId64 " number%s to be sorted", bufLen, bufLen == 1 ? "" : "s");
             XDrawString(display, window, textGC, 10, y, textBuf, strlen(textBuf));
             y = buttons[0].y + buttons[0].height + 10 + textAreaHeight + 20 + font->ascent + font->descent + 20;
             const char *dots = "....";
             const int availableSpace = i_max(1, (windowHeight - y) / (font->ascent + font->descent + 5) - 2);
-            int numStart = bufSelection - availableSpace / 2;
-            int numEnd = bufSelection + (availableSpace + 1) / 2;
+            int64_t numStart = bufSelection - availableSpace / 2;
+            int64_t numEnd = bufSelection + (availableSpace + 1) / 2;
             if(numStart < 0) {
-                numEnd = i_min(numEnd + (-numStart), bufLen);
+                numEnd = i64_min(numEnd + (-numStart), bufLen);
                 numStart = 0;
             } else if(numEnd > bufLen) {
-                numStart = i_max(numStart - (numEnd - bufLen), 0);
+                numStart = i64_max(numStart - (numEnd - bufLen), 0);
                 numEnd = bufLen;
             }
             if(numStart > 0) {
@@ -500,7 +472,7 @@ int main(int argc, char **argv) {
             int arrowX;
             int arrowY;
             assert(numStart >= 0 && numEnd <= bufLen);
-            for(int i = numStart; i < numEnd && i < bufLen; i++) {
+            for(int64_t i = numStart; i < numEnd && i < bufLen; i++) {
                 sprintf(textBuf, "%" PRId64, buf[i]);
                 XDrawString(display, window, i == bufSelection ? selectedTextGC : textGC, 10, y, textBuf, strlen(textBuf));
                 if(i == bufSelection) {
@@ -523,11 +495,19 @@ int main(int argc, char **argv) {
             const char *bigNr = "99999999999999999999999";
             int maxPossibleNumWidth = XTextWidth(font, bigNr, strlen(bigNr));
             selectAlgoButtons[0].x = buttons[0].x + maxPossibleNumWidth + 20;
-            for(int i = 0; i < ALGO_LEN; i++) {
-                drawRadioButton(algo_names[i], selectAlgoButtons[i].x, selectAlgoButtons[i].y, display, window, borderGC, textAreaGC, textGC, font, &selectAlgoButtons[i].width, &selectAlgoButtons[i].height, i == algoSelection);
-                if(i != ALGO_LEN - 1) {
+            int columnWidth = 0;
+            for(int i = 0; i < algoLen; i++) {
+                drawRadioButton(algo_name(i), selectAlgoButtons[i].x, selectAlgoButtons[i].y, display, window, borderGC, textAreaGC, textGC, font, &selectAlgoButtons[i].width, &selectAlgoButtons[i].height, i == algoSelection);
+                columnWidth = i_max(columnWidth, selectAlgoButtons[i].width);
+                if(i != algoLen - 1) {
                     selectAlgoButtons[i + 1].x = selectAlgoButtons[i].x;
                     selectAlgoButtons[i + 1].y = selectAlgoButtons[i].y + selectAlgoButtons[i].height + 10;
+                    if(selectAlgoButtons[i + 1].y + selectAlgoButtons[i].height > windowHeight) {
+                        // plugins can make the list longer than the window, continue in a new column
+                        selectAlgoButtons[i + 1].x += columnWidth + 10;
+                        selectAlgoButtons[i + 1].y = selectAlgoButtons[0].y;
+                        columnWidth = 0;
+                    }
                 }
             }
         }
@@ -543,6 +523,7 @@ int main(int argc, char **argv) {
     XFreeColormap(display, colormap);
     XCloseDisplay(display);
     if(buf) free(buf);
-    write_int(fork_server_fd, -1);
+    free(selectAlgoButtons);
+    write_request(fork_server_fd, &(struct sort_request){ .algoSelection = REQUEST_EXIT });
     close_(fork_server_fd);
 }
@@ -0,0 +1,96 @@
+#include <stdbool.h>
+#include <assert.h>
+
+#include "xsort_anim.h"
+
+int sphere_x(int radius, int i) {
+    return (radius * 2 + 10) * i + radius + 5;
+}
+
+void update_anim_position(struct animation_state *anim) {
+    assert(anim->progress <= anim->end);
+    double percent = (double)anim->progress / anim->end;
+    double x = anim->startX + (anim->targetX - anim->startX) * percent;
+    double y = anim->startY + (anim->targetY - anim->startY) * percent;
+    anim->x = (int)x;
+    anim->y = (int)y;
+}
+
+// moves up to this many spheres take the base duration
+#define ANIM_SHORT_DISTANCE 8
+
+int anim_horizontal_duration(int horizontalDuration, int distance) {
+    // every doubling of the distance adds half the base duration
+    int duration = horizontalDuration;
+    for(int d = ANIM_SHORT_DISTANCE; d < distance; d *= 2) {
+        duration += horizontalDuration / 2;
+    }
+    return duration;
+}
+
+int anim_follow(int focusX, int x, int viewWidth) {
+    focusX += (x - focusX) / 10;
+    int slack = viewWidth / 4;
+    return focusX < x - slack ? x - slack : focusX > x + slack ? x + slack : focusX;
+}
+
+int get_anim_idx(const struct animation_state *anim) {
+    bool is_sphere_1 = anim->state == DOWN_1 || anim->state == RIGHT_1 || anim->state == UP_1;
+    return is_sphere_1 ? anim->sphereIdx1 : anim->sphereIdx2;
+}
+
+void anim_next_phase(struct animation_state *anim, int radius, int viewportHeight, int verticalDuration, int horizontalDuration) {
+    switch(anim->state) {
+        case INIT:
+            // move sphere 1 down
+            anim->x = anim->startX = sphere_x(radius, anim->sphereIdx1);
+            anim->y = anim->startY = viewportHeight / 2;
+            anim->targetX = anim->x;
+            anim->targetY = anim->y + radius * 2 + 10;
+            anim->end = verticalDuration;
+            anim->state = DOWN_1;
+            break;
+        case DOWN_1:
+            // move sphere 1 right
+            anim->startY = anim->y;
+            anim->targetX = sphere_x(radius, anim->sphereIdx2);
+            anim->end = horizontalDuration;
+            anim->state = RIGHT_1;
+            break;
+        case RIGHT_1:
+            // move sphere 2 up to not overlap with sphere 1
+            anim->startX = anim->x;
+            anim->y = anim->startY = viewportHeight / 2;
+            anim->targetY = anim->y - radius * 2 - 10;
+            anim->end = verticalDuration;
+            anim->state = UP_2;
+            break;
+        case UP_2:
+            // move sphere 1 up
+            anim->y = anim->startY = viewportHeight / 2 + radius * 2 + 10;
+            anim->targetY = viewportHeight / 2;
+            anim->end = verticalDuration;
+            anim->state = UP_1;
+            break;
+        case UP_1:
+            // move sphere 2 left
+            anim->startX = anim->x;
+            anim->startY = anim->y = viewportHeight / 2 - radius * 2 - 10;
+            anim->targetX = sphere_x(radius, anim->sphereIdx1);
+            anim->targetY = anim->y;
+            anim->end = horizontalDuration;
+            anim->state = LEFT_2;
+            break;
+        case LEFT_2:
+            // move sphere 2 down
+            anim->startX = anim->x;
+            anim->startY = anim->y;
+            anim->targetY = viewportHeight / 2;
+            anim->end = verticalDuration;
+            anim->state = DOWN_2;
+            break;
+        case DOWN_2:
+            assert(0 && "should not happen");
+    }
+    anim->progress = 0;
+}
@@ -0,0 +1,26 @@
+#include <stdint.h>
+
+// the swap animation, shared by the live renderer and the video export
+// a swap moves sphere 1 down, right and up into the place of sphere 2, while sphere 2 moves up, left and down
+struct animation_state {
+    int x, y;
+    int startX, startY;
+    int targetX, targetY;
+    int progress;
+    int end;
+    int sphereIdx1;
+    int sphereIdx2;
+    enum { INIT, DOWN_1, RIGHT_1, UP_2, UP_1, LEFT_2, DOWN_2 } state;
+};
+
+// center of the sphere at index i at rest
+int sphere_x(int radius, int i);
+void update_anim_position(struct animation_state *anim);
+// index of the element shown on the moving sphere, the buffer is only swapped once the animation is done
+int get_anim_idx(const struct animation_state *anim);
+// duration of a horizontal move over distance spheres, long moves take longer so the view can scroll along
+int anim_horizontal_duration(int horizontalDuration, int distance);
+// next center of the view following the sphere at x: it eases in, but keeps x in the middle half of the view
+int anim_follow(int focusX, int x, int viewWidth);
+// starts the phase after anim->state, must not be called in DOWN_2
+void anim_next_phase(struct animation_state *anim, int radius, int viewportHeight, int verticalDuration, int horizontalDuration);
@@ -0,0 +1,1009 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <math.h>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "utils.h"
+#include "xsort_subproc.h"
+#include "xsort_native.h"
+#include "xsort_tuning.h"
+#include "xsort_cost.h"
+#include "xsort_bench.h"
+
+// largest input the quadratic algorithms are run on
+#define BENCH_QUADRATIC_MAX_LEN 2000
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    // splitmix64, so every run with the same seed produces the same inputs
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+enum distribution { RANDOM, RANDOM_100, RANDOM_1M, FEW_UNIQUE, SORTED, REVERSED, NEARLY_SORTED, DIST_LEN };
+static const char * const dist_names[DIST_LEN] = {
+    [RANDOM] = "random",
+    [RANDOM_100] = "random%100",
+    [RANDOM_1M] = "random%1M",
+    [FEW_UNIQUE] = "few-unique",
+    [SORTED] = "sorted",
+    [REVERSED] = "reversed",
+    [NEARLY_SORTED] = "nearly-sorted",
+};
+
+static void generate_input(int64_t *buf, int64_t len, enum distribution dist) {
+    // few-unique draws from 8 full-range keys, too spread out for counting or radix sort
+    int64_t unique[8];
+    for(int k = 0; k < 8; k++) {
+        unique[k] = (int64_t)rng_next();
+    }
+    for(int64_t i = 0; i < len; i++) {
+        switch(dist) {
+            case RANDOM:
+                buf[i] = (int64_t)rng_next();
+                break;
+            case RANDOM_100:
+                // same range as the Random button in the main window
+                buf[i] = (int64_t)(rng_next() % 100);
+                break;
+            case RANDOM_1M:
+                buf[i] = (int64_t)(rng_next() % 1000000);
+                break;
+            case FEW_UNIQUE:
+                buf[i] = unique[rng_next() % 8];
+                break;
+            case SORTED:
+            case NEARLY_SORTED:
+                buf[i] = i;
+                break;
+            case REVERSED:
+                buf[i] = len - i;
+                break;
+            case DIST_LEN:
+                break;
+        }
+    }
+    if(dist == NEARLY_SORTED) {
+        for(int64_t k = 0; k < len / 100 + 1; k++) {
+            int64_t i = rng_next() % len;
+            int64_t j = rng_next() % len;
+            int64_t tmp = buf[i];
+            buf[i] = buf[j];
+            buf[j] = tmp;
+        }
+    }
+}
+
+// hardware branch miss counter for the native sorts, -1 when perf events are not available
+static int branchMissFd = -1;
+
+static void open_branch_miss_counter(void) {
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HARDWARE,
+        .size = sizeof(struct perf_event_attr),
+        .config = PERF_COUNT_HW_BRANCH_MISSES,
+        .disabled = 1,
+        .exclude_kernel = 1,
+        .exclude_hv = 1,
+    };
+    branchMissFd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if(branchMissFd < 0) {
+        fprintf(stderr, "Branch misses: not available (%s)\n", strerror(errno));
+    }
+}
+
+static void branch_misses_start(void) {
+    if(branchMissFd >= 0) {
+        ioctl(branchMissFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(branchMissFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static int64_t branch_misses_stop(void) {
+    int64_t count;
+    if(branchMissFd < 0) {
+        return -1;
+    }
+    ioctl(branchMissFd, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(branchMissFd, &count, sizeof(count)) != sizeof(count)) {
+        return -1;
+    }
+    return count;
+}
+
+static void print_result(const char *dist, int64_t len, const char *name, int64_t nsec, bool ok, const struct sort_stats *stats, int64_t branchMisses) {
+    char comparisons[32] = "-";
+    char swaps[32] = "-";
+    char reads[32] = "-";
+    char misses[32] = "-";
+    if(stats) {
+        snprintf(comparisons, sizeof(comparisons), "%" PRId64, stats->comparisons);
+        snprintf(swaps, sizeof(swaps), "%" PRId64, stats->swaps);
+        snprintf(reads, sizeof(reads), "%" PRId64, stats->reads);
+    }
+    if(branchMisses >= 0) {
+        snprintf(misses, sizeof(misses), "%" PRId64, branchMisses);
+    }
+    printf("%-14s %9" PRId64 "  %-24s %12.3f %12s %12s %10s %12s%s\n", dist, len, name, nsec / 1e6, comparisons, swaps, reads, misses, ok ? "" : "  SORT BUG");
+    // flush before the next algorithm forks, otherwise the child would print the buffered output again
+    fflush(stdout);
+}
+
+static void bench_size(int64_t len, int64_t k) {
+    int64_t *input = malloc(len * sizeof(int64_t));
+    int64_t *expected = malloc(len * sizeof(int64_t));
+    int64_t *work = malloc(len * sizeof(int64_t));
+    if(!input || !expected || !work) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int dist = 0; dist < DIST_LEN; dist++) {
+        generate_input(input, len, dist);
+        memcpy(expected, input, len * sizeof(int64_t));
+        native_qsort(expected, len);
+
+        // Auto is compared against the cheapest fixed algorithm, by total operations sent over the pipe
+        int64_t autoOps = -1, bestOps = -1;
+        int64_t autoTime = 0, bestTime = 0;
+        const char *bestName = NULL;
+        struct sort_stats autoStats;
+
+        // every algorithm gets its own copy of the same input
+        for(int algo = 0; algo < algo_count() - 1; algo++) {
+            if((algo_flags(algo) & XSORT_CAP_QUADRATIC) && len > BENCH_QUADRATIC_MAX_LEN) {
+                continue;
+            }
+            memcpy(work, input, len * sizeof(int64_t));
+            struct sort_stats stats;
+            int64_t start = get_time_nsec();
+            run_sort_headless(work, len, algo, k, &stats);
+            int64_t elapsed = get_time_nsec() - start;
+            struct sort_goal goal = algo_goal(algo, len, k);
+            if(goal.kind != GOAL_FULL) {
+                // partial sorts are listed with their k, and not compared with Auto
+                char name[64];
+                snprintf(name, sizeof(name), "%s k=%" PRId64, algo_name(algo), goal.k);
+                print_result(dist_names[dist], len, name, elapsed, sort_goal_met(work, len, goal), &stats, -1);
+                continue;
+            }
+            print_result(dist_names[dist], len, algo_name(algo), elapsed, memcmp(work, expected, len * sizeof(int64_t)) == 0, &stats, -1);
+            int64_t ops = stats.comparisons + stats.swaps + stats.reads;
+            if(strcmp(algo_name(algo), "Auto") == 0) {
+                autoOps = ops;
+                autoTime = elapsed;
+                autoStats = stats;
+            } else if(bestOps < 0 || ops < bestOps) {
+                bestOps = ops;
+                bestTime = elapsed;
+                bestName = algo_name(algo);
+            }
+        }
+        if(autoOps >= 0 && bestName) {
+            printf("%-14s %9" PRId64 "  Auto picked \"%s\": %" PRId64 " ops in %.3f ms, best fixed %s: %" PRId64 " ops in %.3f ms\n",
+                dist_names[dist], len, autoStats.notes ? autoStats.note : "?", autoOps, autoTime / 1e6, bestName, bestOps, bestTime / 1e6);
+        }
+        for(int algo = 0; algo < NATIVE_LEN; algo++) {
+            memcpy(work, input, len * sizeof(int64_t));
+            branch_misses_start();
+            int64_t start = get_time_nsec();
+            native_algos[algo](work, len);
+            int64_t elapsed = get_time_nsec() - start;
+            int64_t misses = branch_misses_stop();
+            print_result(dist_names[dist], len, native_names[algo], elapsed, memcmp(work, expected, len * sizeof(int64_t)) == 0, NULL, misses);
+        }
+    }
+    free(input);
+    free(expected);
+    free(work);
+}
+
+static void bench_scaling(int64_t len) {
+    // duplicate-heavy inputs: a three-way partition should need about n * log2(distinct) comparisons,
+    // while two-way partitions keep going over the equal keys
+    static const char * const names[] = { "Quick Sort", "Introsort", "3-Way Quick Sort" };
+    int64_t *input = malloc(len * sizeof(int64_t));
+    int64_t *work = malloc(len * sizeof(int64_t));
+    if(!input || !work) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int64_t distinct = 2; ; distinct *= 8) {
+        distinct = i64_min(distinct, len);
+        for(int64_t i = 0; i < len; i++) {
+            input[i] = (int64_t)(rng_next() % distinct);
+        }
+        double log2Distinct = 0;
+        for(int64_t d = distinct; d > 1; d >>= 1) {
+            log2Distinct++;
+        }
+        for(int k = 0; k < (int)(sizeof(names) / sizeof(names[0])); k++) {
+            int algo = algo_find(names[k]);
+            memcpy(work, input, len * sizeof(int64_t));
+            struct sort_stats stats;
+            run_sort_headless(work, len, algo, 0, &stats);
+            bool ok = sort_goal_met(work, len, (struct sort_goal){ GOAL_FULL, len });
+            printf("%9" PRId64 " %9" PRId64 "  %-24s %12" PRId64 " %12" PRId64 " %16.2f%s\n", len, distinct, names[k], stats.comparisons, stats.swaps,
+                stats.comparisons / (len * log2Distinct), ok ? "" : "  SORT BUG");
+            fflush(stdout);
+        }
+        if(distinct == len) {
+            break;
+        }
+    }
+    free(input);
+    free(work);
+}
+
+static void bench_gaps(int64_t len) {
+    // the diminishing increment sorts on the same random input, their cost is decided by the gap sequence alone
+    int64_t *input = malloc(len * sizeof(int64_t));
+    int64_t *work = malloc(len * sizeof(int64_t));
+    if(!input || !work) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int64_t i = 0; i < len; i++) {
+        input[i] = (int64_t)rng_next();
+    }
+    double log2Len = 0;
+    for(int64_t d = len; d > 1; d >>= 1) {
+        log2Len++;
+    }
+    for(int algo = 0; algo < algo_count() - 1; algo++) {
+        const char *name = algo_name(algo);
+        bool insertion = strcmp(name, "Insertion Sort") == 0;
+        if(strncmp(name, "Shell Sort", 10) != 0 && strncmp(name, "Comb Sort", 9) != 0 && !insertion) {
+            continue;
+        }
+        if(insertion && len > BENCH_QUADRATIC_MAX_LEN) {
+            // only as the gap 1 reference at the small sizes
+            continue;
+        }
+        memcpy(work, input, len * sizeof(int64_t));
+        struct sort_stats stats;
+        int64_t start = get_time_nsec();
+        run_sort_headless(work, len, algo, 0, &stats);
+        int64_t elapsed = get_time_nsec() - start;
+        bool ok = sort_goal_met(work, len, (struct sort_goal){ GOAL_FULL, len });
+        printf("%9" PRId64 "  %-24s %12" PRId64 " %12" PRId64 " %6d %14.2f %12.3f%s\n", len, name, stats.comparisons, stats.swaps, stats.phases,
+            log2Len > 0 ? stats.comparisons / (len * log2Len) : 0, elapsed / 1e6, ok ? "" : "  SORT BUG");
+        fflush(stdout);
+    }
+    free(input);
+    free(work);
+}
+
+#define TYPES_REPS 3
+
+static void bench_types(int64_t len, const char *algoName) {
+    // the same numbers sorted as every element type: the comparisons stay about the same,
+    // the cost of a swap follows the element size until the records are sorted through an index
+    int algo = algo_find(algoName);
+    if(algo < 0) {
+        fprintf(stderr, "Unknown algorithm \"%s\"\n", algoName);
+        exit(1);
+    }
+    int64_t *input = malloc(len * sizeof(int64_t));
+    if(!input) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int64_t i = 0; i < len; i++) {
+        input[i] = (int64_t)(rng_next() % 1000000);
+    }
+    for(int type = 0; type < ELEM_TYPES_LEN; type++) {
+        struct elem_buf eb;
+        elem_buf_init(&eb, type, input, len);
+        struct sort_stats stats;
+        struct sort_op_log log = {0};
+        run_sort_headless_elems(&eb, algo, 0, &stats, &log);
+        int64_t *swaps = sort_op_log_swaps(&log);
+        free(log.ops);
+        bool ok = elem_sorted(&eb);
+        uint64_t bytesMoved = eb.bytesMoved;
+        elem_buf_free(&eb);
+
+        // the headless run is dominated by the pipe, so the recorded swaps are replayed in-process for the timing
+        int64_t bestReplay = INT64_MAX, bestSettle = INT64_MAX;
+        for(int rep = 0; rep < TYPES_REPS; rep++) {
+            elem_buf_init(&eb, type, input, len);
+            int64_t start = get_time_nsec();
+            eb.type->replay(&eb, swaps, stats.swaps);
+            int64_t mid = get_time_nsec();
+            elem_settle(&eb);
+            int64_t end = get_time_nsec();
+            bestReplay = bestReplay < mid - start ? bestReplay : mid - start;
+            bestSettle = bestSettle < end - mid ? bestSettle : end - mid;
+            elem_buf_free(&eb);
+        }
+        printf("%9" PRId64 "  %-20s %-14s %6zu %12" PRId64 " %12" PRId64 " %14" PRIu64 " %10.2f %10.3f%s\n", len, algoName, elem_types[type].name, elem_types[type].size,
+            stats.comparisons, stats.swaps, bytesMoved, stats.swaps ? (double)bestReplay / stats.swaps : 0, bestSettle / 1e6, ok ? "" : "  SORT BUG");
+        fflush(stdout);
+        free(swaps);
+    }
+    free(input);
+}
+
+// element sizes the op streams are priced at, the last one through an index like the large record types
+static const struct {
+    size_t size;
+    bool indirect;
+    const char *label;
+} cost_columns[] = {
+    { 8, false, "8 B" },
+    { 64, false, "64 B" },
+    { 1024, false, "1 KB" },
+    { 4096, false, "4 KB" },
+    { 4096, true, "4 KB idx" },
+};
+#define COST_COLUMNS_LEN ((int)(sizeof(cost_columns) / sizeof(cost_columns[0])))
+
+static void bench_cost(int64_t len, const struct cost_model *model) {
+    // the same recorded op stream of every algorithm priced at several element sizes:
+    // with cheap moves the fewest comparisons win, with 4 KB records the fewest swaps
+    int64_t *work = malloc(len * sizeof(int64_t));
+    int64_t *input = malloc(len * sizeof(int64_t));
+    if(!work || !input) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int64_t i = 0; i < len; i++) {
+        input[i] = (int64_t)rng_next();
+    }
+    double best[COST_COLUMNS_LEN];
+    const char *bestName[COST_COLUMNS_LEN] = {0};
+    for(int algo = 0; algo < algo_count() - 1; algo++) {
+        if(((algo_flags(algo) & XSORT_CAP_QUADRATIC) && len > BENCH_QUADRATIC_MAX_LEN) || algo_goal(algo, len, 0).kind != GOAL_FULL) {
+            continue;
+        }
+        memcpy(work, input, len * sizeof(int64_t));
+        struct elem_buf eb;
+        elem_buf_wrap(&eb, work, len);
+        struct sort_stats stats;
+        struct sort_op_log log = {0};
+        run_sort_headless_elems(&eb, algo, 0, &stats, &log);
+        printf("%9" PRId64 "  %-24s %12" PRId64 " %12" PRId64 " %10" PRId64, len, algo_name(algo), stats.comparisons, stats.swaps, stats.reads);
+        for(int c = 0; c < COST_COLUMNS_LEN; c++) {
+            struct cost_estimate estimate;
+            cost_estimate(model, &log, len, cost_columns[c].size, cost_columns[c].indirect, &estimate);
+            double ms = cost_total(&estimate) / 1e6;
+            printf(" %10.3f", ms);
+            if(!bestName[c] || ms < best[c]) {
+                best[c] = ms;
+                bestName[c] = algo_name(algo);
+            }
+        }
+        printf("%s\n", elem_sorted(&eb) ? "" : "  SORT BUG");
+        fflush(stdout);
+        free(log.ops);
+    }
+    for(int c = 0; c < COST_COLUMNS_LEN; c++) {
+        if(bestName[c]) {
+            printf("%9" PRId64 "  fastest at %s: %s (%.3f ms)\n", len, cost_columns[c].label, bestName[c], best[c]);
+        }
+    }
+    free(work);
+    free(input);
+}
+
+// regression check: a fixed matrix of algorithms, inputs and seeds compared with a baseline file in the repo
+// the counts are deterministic and must match exactly, the times are compared with a rank test
+
+#define REGRESS_BASELINE "bench_baseline.txt"
+#define REGRESS_REPS 5
+// a cell fails when its median time grew by more than this and the rank test agrees
+#define REGRESS_SLOWDOWN 0.20
+#define REGRESS_P_VALUE 0.01
+// a slowdown of every cell, like one in the pipe protocol, is too small to show in single cells,
+// so the median ratios of all instrumented and all native cells are tested together as well
+#define REGRESS_GROUP_SLOWDOWN 0.10
+// the native sorts take too little time at the instrumented sizes to measure
+#define REGRESS_NATIVE_LEN 100000
+
+static const char * const regress_algos[] = {
+    "Insertion Sort", "Quick Sort", "Heap Sort", "3-Way Quick Sort", "Introsort",
+    "BlockQuicksort", "Timsort", "Bitonic Sort", "Odd-Even Merge Sort", "Auto", "Shell Sort (Ciura)", "Comb Sort (Comb11)",
+};
+#define REGRESS_ALGOS_LEN ((int)(sizeof(regress_algos) / sizeof(regress_algos[0])))
+static const enum distribution regress_dists[] = { RANDOM, FEW_UNIQUE, NEARLY_SORTED };
+#define REGRESS_DISTS_LEN ((int)(sizeof(regress_dists) / sizeof(regress_dists[0])))
+// the quadratic sorts only run at the first size
+static const int64_t regress_sizes[] = { 250, 1000 };
+#define REGRESS_SIZES_LEN ((int)(sizeof(regress_sizes) / sizeof(regress_sizes[0])))
+static const uint64_t regress_seeds[] = { 1, 2 };
+#define REGRESS_SEEDS_LEN ((int)(sizeof(regress_seeds) / sizeof(regress_seeds[0])))
+
+struct regress_cell {
+    char algo[64];
+    char dist[32];
+    int64_t len;
+    uint64_t seed;
+    // -1 for the native sorts, which are not instrumented
+    int64_t comparisons, swaps, reads;
+    int64_t nsec[REGRESS_REPS];
+    int reps;
+    bool ok;
+};
+
+struct regress_cells {
+    struct regress_cell *cells;
+    int len, cap;
+};
+
+static struct regress_cell *regress_add(struct regress_cells *cells) {
+    if(cells->len == cells->cap) {
+        cells->cap = cells->cap ? cells->cap * 2 : 64;
+        cells->cells = realloc(cells->cells, cells->cap * sizeof(struct regress_cell));
+        if(!cells->cells) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    struct regress_cell *cell = &cells->cells[cells->len++];
+    *cell = (struct regress_cell){ .comparisons = -1, .swaps = -1, .reads = -1, .ok = true };
+    return cell;
+}
+
+static const struct regress_cell *regress_find(const struct regress_cells *cells, const struct regress_cell *key) {
+    for(int i = 0; i < cells->len; i++) {
+        const struct regress_cell *cell = &cells->cells[i];
+        if(strcmp(cell->algo, key->algo) == 0 && strcmp(cell->dist, key->dist) == 0 && cell->len == key->len && cell->seed == key->seed) {
+            return cell;
+        }
+    }
+    return NULL;
+}
+
+static bool regress_load(const char *path, struct regress_cells *cells) {
+    // one cell per line, tab separated: algorithm, distribution, n, seed, comparisons, swaps, reads
+    // and the times of every repetition in nanoseconds, separated by commas
+    FILE *f = fopen(path, "r");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    char line[1024];
+    int lineNr = 0;
+    while(fgets(line, sizeof(line), f)) {
+        lineNr++;
+        if(line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        char *fields[8];
+        int fieldsLen = 0;
+        char *save;
+        for(char *field = strtok_r(line, "\t", &save); field && fieldsLen < 8; field = strtok_r(NULL, "\t", &save)) {
+            fields[fieldsLen++] = field;
+        }
+        if(fieldsLen != 8) {
+            fprintf(stderr, "%s:%d: expected 8 tab separated fields\n", path, lineNr);
+            continue;
+        }
+        struct regress_cell *cell = regress_add(cells);
+        snprintf(cell->algo, sizeof(cell->algo), "%s", fields[0]);
+        snprintf(cell->dist, sizeof(cell->dist), "%s", fields[1]);
+        cell->len = strtoll(fields[2], NULL, 10);
+        cell->seed = strtoull(fields[3], NULL, 10);
+        cell->comparisons = strtoll(fields[4], NULL, 10);
+        cell->swaps = strtoll(fields[5], NULL, 10);
+        cell->reads = strtoll(fields[6], NULL, 10);
+        for(char *time = strtok_r(fields[7], ",", &save); time && cell->reps < REGRESS_REPS; time = strtok_r(NULL, ",", &save)) {
+            cell->nsec[cell->reps++] = strtoll(time, NULL, 10);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool regress_save(const char *path, const struct regress_cells *cells) {
+    FILE *f = fopen(path, "w");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "# written by xsort --bench --regress --update, read by make bench\n");
+    fprintf(f, "# the times only mean something on the machine and with the CFLAGS that wrote them\n");
+    fprintf(f, "# algorithm\tdistribution\tn\tseed\tcomparisons\tswaps\treads\tnsec per repetition\n");
+    for(int i = 0; i < cells->len; i++) {
+        const struct regress_cell *cell = &cells->cells[i];
+        fprintf(f, "%s\t%s\t%" PRId64 "\t%" PRIu64 "\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t", cell->algo, cell->dist, cell->len, cell->seed,
+            cell->comparisons, cell->swaps, cell->reads);
+        for(int rep = 0; rep < cell->reps; rep++) {
+            fprintf(f, "%s%" PRId64, rep ? "," : "", cell->nsec[rep]);
+        }
+        fprintf(f, "\n");
+    }
+    if(fclose(f) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+static void regress_measure(struct regress_cells *cells) {
+    int64_t maxLen = REGRESS_NATIVE_LEN;
+    for(int s = 0; s < REGRESS_SIZES_LEN; s++) {
+        maxLen = i64_max(maxLen, regress_sizes[s]);
+    }
+    int64_t *input = malloc(maxLen * sizeof(int64_t));
+    int64_t *expected = malloc(maxLen * sizeof(int64_t));
+    int64_t *work = malloc(maxLen * sizeof(int64_t));
+    if(!input || !expected || !work) {
+        perror("malloc");
+        exit(1);
+    }
+    // the repetitions go over the whole matrix in turn, so a slow phase of the machine
+    // spreads over all cells instead of shifting the times of a few
+    for(int rep = 0; rep < REGRESS_REPS; rep++) {
+        int c = 0;
+        for(int s = 0; s <= REGRESS_SIZES_LEN; s++) {
+            // the sizes of the instrumented sorts, then the native size
+            bool native = s == REGRESS_SIZES_LEN;
+            int64_t len = native ? REGRESS_NATIVE_LEN : regress_sizes[s];
+            for(int d = 0; d < REGRESS_DISTS_LEN; d++) {
+                for(int seed = 0; seed < REGRESS_SEEDS_LEN; seed++) {
+                    rng_state = regress_seeds[seed];
+                    generate_input(input, len, regress_dists[d]);
+                    memcpy(expected, input, len * sizeof(int64_t));
+                    native_qsort(expected, len);
+                    for(int a = 0; a < (native ? NATIVE_LEN : REGRESS_ALGOS_LEN); a++) {
+                        int algo = native ? a : algo_find(regress_algos[a]);
+                        if(algo < 0) {
+                            fprintf(stderr, "Unknown algorithm \"%s\"\n", regress_algos[a]);
+                            exit(1);
+                        }
+                        if(!native && (algo_flags(algo) & XSORT_CAP_QUADRATIC) && len > regress_sizes[0]) {
+                            continue;
+                        }
+                        struct regress_cell *cell;
+                        if(rep == 0) {
+                            cell = regress_add(cells);
+                            snprintf(cell->algo, sizeof(cell->algo), "%s", native ? native_names[algo] : algo_name(algo));
+                            snprintf(cell->dist, sizeof(cell->dist), "%s", dist_names[regress_dists[d]]);
+                            cell->len = len;
+                            cell->seed = regress_seeds[seed];
+                        } else {
+                            cell = &cells->cells[c];
+                        }
+                        c++;
+                        memcpy(work, input, len * sizeof(int64_t));
+                        struct sort_stats stats;
+                        int64_t start = get_time_nsec();
+                        if(native) {
+                            native_algos[algo](work, len);
+                        } else {
+                            run_sort_headless(work, len, algo, 0, &stats);
+                        }
+                        cell->nsec[cell->reps++] = get_time_nsec() - start;
+                        cell->ok &= memcmp(work, expected, len * sizeof(int64_t)) == 0;
+                        if(!native && rep == 0) {
+                            cell->comparisons = stats.comparisons;
+                            cell->swaps = stats.swaps;
+                            cell->reads = stats.reads;
+                        } else if(!native && (stats.comparisons != cell->comparisons || stats.swaps != cell->swaps || stats.reads != cell->reads)) {
+                            // the same input must always produce the same requests
+                            cell->ok = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    free(input);
+    free(expected);
+    free(work);
+}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double regress_median(const int64_t *nsec, int len) {
+    int64_t sorted[REGRESS_REPS];
+    memcpy(sorted, nsec, len * sizeof(int64_t));
+    qsort(sorted, len, sizeof(int64_t), compare_i64);
+    return len % 2 ? sorted[len / 2] : (sorted[len / 2 - 1] + sorted[len / 2]) / 2.0;
+}
+
+static double regress_p_slower(const struct regress_cell *base, const struct regress_cell *cur) {
+    // one-sided Mann-Whitney U test that the current times tend to be larger than the baseline ones,
+    // with the normal approximation and a continuity correction
+    double u = 0;
+    for(int i = 0; i < base->reps; i++) {
+        for(int j = 0; j < cur->reps; j++) {
+            u += cur->nsec[j] > base->nsec[i] ? 1 : cur->nsec[j] == base->nsec[i] ? 0.5 : 0;
+        }
+    }
+    double n1 = base->reps, n2 = cur->reps;
+    double z = (u - n1 * n2 / 2 - 0.5) / sqrt(n1 * n2 * (n1 + n2 + 1) / 12);
+    return 0.5 * erfc(z / sqrt(2));
+}
+
+static int compare_abs(const void *a, const void *b) {
+    double x = fabs(*(const double *)a), y = fabs(*(const double *)b);
+    return (x > y) - (x < y);
+}
+
+static double regress_p_group_slower(double *logRatios, int len) {
+    // one-sided Wilcoxon signed-rank test that the log ratios of current to baseline median are above zero
+    qsort(logRatios, len, sizeof(double), compare_abs);
+    double w = 0;
+    for(int i = 0; i < len; i++) {
+        if(logRatios[i] > 0) {
+            w += i + 1;
+        }
+    }
+    double n = len;
+    double z = (w - n * (n + 1) / 4 - 0.5) / sqrt(n * (n + 1) * (2 * n + 1) / 24);
+    return 0.5 * erfc(z / sqrt(2));
+}
+
+static bool regress_group(const char *name, double *logRatios, int len) {
+    if(len == 0) {
+        return true;
+    }
+    double sum = 0;
+    for(int i = 0; i < len; i++) {
+        sum += logRatios[i];
+    }
+    double change = exp(sum / len) - 1;
+    double p = regress_p_group_slower(logRatios, len);
+    bool slower = change > REGRESS_GROUP_SLOWDOWN && p < REGRESS_P_VALUE;
+    printf("%-22s %4d cells, geometric mean change %+.1f%%, p %.4f  %s\n", name, len, change * 100, p, slower ? "SLOWER" : "ok");
+    return !slower;
+}
+
+static int regress_main(const char *path, bool update, bool countsOnly) {
+    // the tuning file changes the counts of the hybrid sorts, the matrix always runs with the defaults
+    tuning_reset();
+    struct regress_cells base = {0};
+    if(!update && !regress_load(path, &base)) {
+        fprintf(stderr, "No baseline, write one with make bench-baseline\n");
+        return 1;
+    }
+    struct regress_cells cur = {0};
+    regress_measure(&cur);
+    if(update) {
+        for(int i = 0; i < cur.len; i++) {
+            if(!cur.cells[i].ok) {
+                fprintf(stderr, "%s failed on %s n=%" PRId64 " seed=%" PRIu64 ", not writing a baseline\n", cur.cells[i].algo, cur.cells[i].dist, cur.cells[i].len, cur.cells[i].seed);
+                return 1;
+            }
+        }
+        if(!regress_save(path, &cur)) {
+            return 1;
+        }
+        fprintf(stderr, "Saved %d cells to %s\n", cur.len, path);
+        free(cur.cells);
+        return 0;
+    }
+
+    int failures = 0;
+    double *logRatios[2] = { malloc(cur.len * sizeof(double)), malloc(cur.len * sizeof(double)) };
+    int logRatiosLen[2] = {0};
+    if(!logRatios[0] || !logRatios[1]) {
+        perror("malloc");
+        exit(1);
+    }
+    printf("%-22s %-14s %6s %4s %12s %12s %8s %8s  %s\n", "algorithm", "distribution", "n", "seed", "base ms", "ms", "change", "p", "result");
+    for(int i = 0; i < cur.len; i++) {
+        const struct regress_cell *cell = &cur.cells[i];
+        const struct regress_cell *old = regress_find(&base, cell);
+        const char *result = "ok";
+        double baseMs = 0, ms = regress_median(cell->nsec, cell->reps) / 1e6, p = 1;
+        if(!cell->ok) {
+            result = "SORT BUG";
+        } else if(!old) {
+            result = "no baseline";
+        } else if(cell->comparisons != old->comparisons || cell->swaps != old->swaps || cell->reads != old->reads) {
+            result = "COUNTS CHANGED";
+        } else {
+            baseMs = regress_median(old->nsec, old->reps) / 1e6;
+            p = regress_p_slower(old, cell);
+            // instrumented and native cells are grouped separately, they share no code path
+            int group = cell->comparisons < 0;
+            logRatios[group][logRatiosLen[group]++] = log(ms / baseMs);
+            if(!countsOnly && ms > baseMs * (1 + REGRESS_SLOWDOWN) && p < REGRESS_P_VALUE) {
+                result = "SLOWER";
+            }
+        }
+        bool failed = strcmp(result, "ok") != 0 && strcmp(result, "no baseline") != 0;
+        failures += failed;
+        printf("%-22s %-14s %6" PRId64 " %4" PRIu64 " %12.3f %12.3f %+7.1f%% %8.4f  %s\n", cell->algo, cell->dist, cell->len, cell->seed, baseMs, ms,
+            baseMs > 0 ? (ms / baseMs - 1) * 100 : 0, p, result);
+        if(strcmp(result, "COUNTS CHANGED") == 0) {
+            printf("    comparisons %" PRId64 " -> %" PRId64 ", swaps %" PRId64 " -> %" PRId64 ", reads %" PRId64 " -> %" PRId64 "\n",
+                old->comparisons, cell->comparisons, old->swaps, cell->swaps, old->reads, cell->reads);
+        }
+        fflush(stdout);
+    }
+    printf("%d of %d cells regressed\n", failures, cur.len);
+    if(!countsOnly) {
+        failures += !regress_group("instrumented", logRatios[0], logRatiosLen[0]);
+        failures += !regress_group("native", logRatios[1], logRatiosLen[1]);
+    }
+    free(logRatios[0]);
+    free(logRatios[1]);
+    if(failures) {
+        fprintf(stderr, "If the change is intended, update the baseline with make bench-baseline\n");
+    }
+    free(base.cells);
+    free(cur.cells);
+    return failures ? 1 : 0;
+}
+
+int bench_main(int argc, char **argv) {
+    // usage: xsort --bench [--seed N] [--k K] [--scaling | --gaps | --types [--algo NAME] | --cost [--model FILE]] [SIZE...]
+    //        xsort --bench --regress [--baseline FILE] [--update] [--counts-only]
+    // K is passed to the partial sorts, by default 1% of each size
+    // --scaling runs the duplicate-heavy suite instead of the distribution table
+    // --gaps compares the gap sequences of Shell sort and the shrink factors of comb sort, up to 100000 by default
+    // --types sorts the same input as every element type, with Quick Sort unless --algo is given
+    // --cost prices the recorded requests of every algorithm with the cost model in FILE, or the defaults
+    // --regress runs a fixed matrix and fails when it is slower than the baseline FILE (bench_baseline.txt)
+    // or its counts changed, --update rewrites the baseline and --counts-only skips the times, for other machines
+    uint64_t seed = 1;
+    int64_t k = 0;
+    bool scaling = false;
+    bool gaps = false;
+    bool types = false;
+    const char *algoName = "Quick Sort";
+    bool cost = false;
+    struct cost_model model = cost_model_default;
+    bool regress = false, update = false, countsOnly = false;
+    const char *baseline = REGRESS_BASELINE;
+    int64_t sizes[64];
+    int sizesLen = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if(strcmp(argv[i], "--gaps") == 0) {
+            gaps = true;
+        } else if(strcmp(argv[i], "--types") == 0) {
+            types = true;
+        } else if(strcmp(argv[i], "--algo") == 0 && i + 1 < argc) {
+            algoName = argv[++i];
+        } else if(strcmp(argv[i], "--cost") == 0) {
+            cost = true;
+        } else if(strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            if(!cost_load(argv[++i], &model)) {
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--regress") == 0) {
+            regress = true;
+        } else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if(strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if(strcmp(argv[i], "--counts-only") == 0) {
+            countsOnly = true;
+        } else if(strcmp(argv[i], "--k") == 0 && i + 1 < argc) {
+            k = strtoll(argv[++i], NULL, 10);
+        } else if(sizesLen < (int)(sizeof(sizes) / sizeof(sizes[0]))) {
+            int64_t len = strtoll(argv[i], NULL, 10);
+            if(len <= 0) {
+                fprintf(stderr, "Invalid size \"%s\"\n", argv[i]);
+                return 1;
+            }
+            sizes[sizesLen++] = len;
+        }
+    }
+    if(regress) {
+        return regress_main(baseline, update, countsOnly);
+    }
+    if(sizesLen == 0 && gaps) {
+        // the gap sequences only pull apart at large sizes
+        sizes[sizesLen++] = 1000;
+        sizes[sizesLen++] = 10000;
+        sizes[sizesLen++] = 100000;
+    }
+    if(sizesLen == 0) {
+        sizes[sizesLen++] = 1000;
+        if(!cost) {
+            // the quadratic sorts are part of the cost comparison, so it stays at a size they run at
+            sizes[sizesLen++] = 10000;
+        }
+    }
+
+    if(cost) {
+        printf("# cost model\n");
+        cost_print(stdout, &model);
+        printf("%9s  %-24s %12s %12s %10s", "n", "algorithm", "comparisons", "swaps", "reads");
+        for(int c = 0; c < COST_COLUMNS_LEN; c++) {
+            char label[32];
+            snprintf(label, sizeof(label), "ms@%s", cost_columns[c].label);
+            printf(" %10s", label);
+        }
+        printf("\n");
+        fflush(stdout);
+        for(int i = 0; i < sizesLen; i++) {
+            rng_state = seed;
+            bench_cost(sizes[i], &model);
+        }
+        return 0;
+    }
+
+    if(scaling) {
+        printf("%9s %9s  %-24s %12s %12s %16s\n", "n", "distinct", "algorithm", "comparisons", "swaps", "cmp/(n*log2 d)");
+        fflush(stdout);
+        for(int i = 0; i < sizesLen; i++) {
+            rng_state = seed;
+            bench_scaling(sizes[i]);
+        }
+        return 0;
+    }
+
+    if(gaps) {
+        printf("%9s  %-24s %12s %12s %6s %14s %12s\n", "n", "algorithm", "comparisons", "swaps", "gaps", "cmp/(n*log2 n)", "time (ms)");
+        fflush(stdout);
+        for(int i = 0; i < sizesLen; i++) {
+            rng_state = seed;
+            bench_gaps(sizes[i]);
+        }
+        return 0;
+    }
+
+    if(types) {
+        printf("%9s  %-20s %-14s %6s %12s %12s %14s %10s %10s\n", "n", "algorithm", "type", "bytes", "comparisons", "swaps", "bytes moved", "ns/swap", "settle ms");
+        fflush(stdout);
+        for(int i = 0; i < sizesLen; i++) {
+            rng_state = seed;
+            bench_types(sizes[i], algoName);
+        }
+        return 0;
+    }
+
+    fprintf(stderr, "AVX2 Sort: %s\n", native_avx2_available() ? "vectorized path" : "scalar fallback");
+    open_branch_miss_counter();
+    printf("%-14s %9s  %-24s %12s %12s %12s %10s %12s\n", "distribution", "n", "algorithm", "time (ms)", "comparisons", "swaps", "reads", "br-misses");
+    fflush(stdout);
+    for(int i = 0; i < sizesLen; i++) {
+        rng_state = seed;
+        bench_size(sizes[i], k > 0 ? k : sizes[i] / 100 + 1);
+    }
+    return 0;
+}
+
+// auto-tuner: each setting is swept in turn with the others fixed, and the fastest value is kept
+
+#define TUNE_REPS 3
+
+struct tune_param {
+    const char *name;
+    int *value;
+    int candidates[8];
+    int candidatesLen;
+    // native sorts are timed in-process, instrumented ones through run_sort_headless
+    bool native;
+    const char *algos[3];
+    int algosLen;
+    enum distribution dists[3];
+    int distsLen;
+};
+
+static int find_native(const char *name) {
+    for(int algo = 0; algo < NATIVE_LEN; algo++) {
+        if(strcmp(native_names[algo], name) == 0) {
+            return algo;
+        }
+    }
+    return -1;
+}
+
+static int64_t tune_measure(const struct tune_param *param, int len, int64_t *input, int64_t *work) {
+    // total over inputs and algorithms of the best of TUNE_REPS runs
+    int64_t total = 0;
+    for(int d = 0; d < param->distsLen; d++) {
+        rng_state = 1;
+        generate_input(input, len, param->dists[d]);
+        for(int a = 0; a < param->algosLen; a++) {
+            int algo = param->native ? find_native(param->algos[a]) : algo_find(param->algos[a]);
+            if(algo < 0) {
+                fprintf(stderr, "Unknown algorithm \"%s\"\n", param->algos[a]);
+                exit(1);
+            }
+            int64_t best = INT64_MAX;
+            for(int rep = 0; rep < TUNE_REPS; rep++) {
+                memcpy(work, input, len * sizeof(int64_t));
+                int64_t start = get_time_nsec();
+                if(param->native) {
+                    native_algos[algo](work, len);
+                } else {
+                    struct sort_stats stats;
+                    run_sort_headless(work, len, algo, 0, &stats);
+                }
+                int64_t elapsed = get_time_nsec() - start;
+                best = elapsed < best ? elapsed : best;
+            }
+            total += best;
+        }
+    }
+    return total;
+}
+
+int tune_main(int argc, char **argv) {
+    // usage: xsort --tune [--out FILE] [SIZE [NATIVE_SIZE]]
+    // SIZE is used for the instrumented sorts, NATIVE_SIZE for the native ones
+    const char *out = tuning_file();
+    int len = 2000, nativeLen = 200000;
+    int sizesLen = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if(sizesLen < 2) {
+            int size = atoi(argv[i]);
+            if(size <= 0) {
+                fprintf(stderr, "Invalid size \"%s\"\n", argv[i]);
+                return 1;
+            }
+            *(sizesLen++ == 0 ? &len : &nativeLen) = size;
+        }
+    }
+    struct tune_param params[] = {
+        { "insertion_cutoff", &tuning.insertionCutoff, { 4, 8, 12, 16, 24, 32 }, 6, false,
+            { "Introsort", "3-Way Quick Sort", "BlockQuicksort" }, 3, { RANDOM, RANDOM_100, NEARLY_SORTED }, 3 },
+        { "pivot_sample", &tuning.pivotSample, { 1, 3, 9 }, 3, false,
+            { "Introsort", "3-Way Quick Sort", "BlockQuicksort" }, 3, { RANDOM, RANDOM_100, NEARLY_SORTED }, 3 },
+        { "block_size", &tuning.blockSize, { 4, 8, 16, 32, 64 }, 5, false,
+            { "BlockQuicksort" }, 1, { RANDOM, RANDOM_100 }, 2 },
+        { "radix_bits", &tuning.radixBits, { 4, 6, 8, 10, 12 }, 5, false,
+            { "Auto" }, 1, { RANDOM_1M }, 1 },
+        { "native_insertion_cutoff", &tuning.nativeInsertionCutoff, { 8, 12, 16, 24, 32, 48 }, 6, true,
+            { "pdqsort", "BlockQuicksort" }, 2, { RANDOM, RANDOM_100, NEARLY_SORTED }, 3 },
+        { "native_block_size", &tuning.nativeBlockSize, { 16, 32, 64, 96, 128 }, 5, true,
+            { "BlockQuicksort" }, 1, { RANDOM, RANDOM_100 }, 2 },
+    };
+    int maxLen = len > nativeLen ? len : nativeLen;
+    int64_t *input = malloc(maxLen * sizeof(int64_t));
+    int64_t *work = malloc(maxLen * sizeof(int64_t));
+    if(!input || !work) {
+        perror("malloc");
+        exit(1);
+    }
+    printf("%-24s %9s %12s\n", "setting", "value", "time (ms)");
+    fflush(stdout);
+    for(int p = 0; p < (int)(sizeof(params) / sizeof(params[0])); p++) {
+        struct tune_param *param = &params[p];
+        int bestValue = *param->value;
+        int64_t bestTime = INT64_MAX;
+        for(int c = 0; c < param->candidatesLen; c++) {
+            *param->value = param->candidates[c];
+            int64_t elapsed = tune_measure(param, param->native ? nativeLen : len, input, work);
+            printf("%-24s %9d %12.3f\n", param->name, param->candidates[c], elapsed / 1e6);
+            fflush(stdout);
+            if(elapsed < bestTime) {
+                bestTime = elapsed;
+                bestValue = param->candidates[c];
+            }
+        }
+        *param->value = bestValue;
+        printf("%-24s %9d  <- fastest\n", param->name, bestValue);
+        fflush(stdout);
+    }
+    free(input);
+    free(work);
+    if(!tuning_save(out)) {
+        return 1;
+    }
+    fprintf(stderr, "Saved tuning to %s:\n", out);
+    tuning_print(stderr);
+    return 0;
+}
@@ -0,0 +1,3 @@
+int bench_main(int argc, char **argv);
+// sweeps the thresholds in xsort_tuning.h and writes the fastest values to the tuning file
+int tune_main(int argc, char **argv);
@@ -0,0 +1,241 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "xsort_protocol.h"
+#include "xsort_client.h"
+
+// pending swaps are sent once the batch reaches this size
+#define CLIENT_BATCH_BYTES (64 << 10)
+// compares per OPS frame, so a frame with the pending swaps in front stays under XSORT_MAX_FRAME
+#define CLIENT_MAX_COMPARES ((XSORT_MAX_FRAME - CLIENT_BATCH_BYTES) / 9)
+
+struct xsort_client {
+    int fd;
+    bool broken;
+    uint8_t *batch;
+    uint32_t batchLen;
+    uint32_t batchCap;
+};
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static bool send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while(len > 0) {
+        ssize_t bytes = send(fd, p, len, MSG_NOSIGNAL);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        p += bytes;
+        len -= bytes;
+    }
+    return true;
+}
+
+static bool recv_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while(len > 0) {
+        ssize_t bytes = recv(fd, p, len, 0);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        if(bytes == 0) {
+            errno = ECONNRESET;
+            return false;
+        }
+        p += bytes;
+        len -= bytes;
+    }
+    return true;
+}
+
+static bool reserve(struct xsort_client *client, uint32_t bytes) {
+    if(client->batchLen + bytes <= client->batchCap) {
+        return true;
+    }
+    uint32_t cap = client->batchCap * 2;
+    while(cap < client->batchLen + bytes) {
+        cap *= 2;
+    }
+    uint8_t *batch = realloc(client->batch, cap);
+    if(!batch) {
+        return false;
+    }
+    client->batch = batch;
+    client->batchCap = cap;
+    return true;
+}
+
+static int flush(struct xsort_client *client) {
+    // the batch buffer starts with room for the frame header, filled in here
+    if(client->broken) {
+        return -1;
+    }
+    if(client->batchLen == 5) {
+        return 0;
+    }
+    client->batch[0] = XSORT_FRAME_OPS;
+    put_u32(client->batch + 1, client->batchLen - 5);
+    if(!send_all(client->fd, client->batch, client->batchLen)) {
+        client->broken = true;
+        return -1;
+    }
+    client->batchLen = 5;
+    return 0;
+}
+
+static int append_op(struct xsort_client *client, uint8_t op, uint32_t i, uint32_t j) {
+    if(client->broken || !reserve(client, 9)) {
+        return -1;
+    }
+    uint8_t *p = client->batch + client->batchLen;
+    p[0] = op;
+    put_u32(p + 1, i);
+    put_u32(p + 5, j);
+    client->batchLen += 9;
+    return 0;
+}
+
+struct xsort_client *xsort_client_connect(const char *path, const char *name, const int64_t *values, uint32_t count) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    size_t nameLen = strlen(name);
+    if(strlen(path) >= sizeof(addr.sun_path) || nameLen > UINT16_MAX) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    // the server drops a larger HELLO without an answer, refuse it before connecting
+    size_t len = 5 + 10 + nameLen + (size_t)count * 8;
+    if(len - 5 > XSORT_MAX_FRAME) {
+        errno = EMSGSIZE;
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        return NULL;
+    }
+    if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t *hello = malloc(len);
+    if(!hello) {
+        close(fd);
+        return NULL;
+    }
+    hello[0] = XSORT_FRAME_HELLO;
+    put_u32(hello + 1, len - 5);
+    put_u32(hello + 5, XSORT_PROTOCOL_VERSION);
+    hello[9] = nameLen;
+    hello[10] = nameLen >> 8;
+    memcpy(hello + 11, name, nameLen);
+    put_u32(hello + 11 + nameLen, count);
+    uint8_t *p = hello + 15 + nameLen;
+    for(uint32_t i = 0; i < count; i++) {
+        put_u32(p + i * 8, (uint64_t)values[i]);
+        put_u32(p + i * 8 + 4, (uint64_t)values[i] >> 32);
+    }
+    uint8_t reply[4];
+    bool ok = send_all(fd, hello, len) && recv_all(fd, reply, sizeof(reply));
+    free(hello);
+    if(ok && get_u32(reply) != XSORT_PROTOCOL_VERSION) {
+        errno = EPROTO;
+        ok = false;
+    }
+    if(!ok) {
+        close(fd);
+        return NULL;
+    }
+
+    struct xsort_client *client = malloc(sizeof(struct xsort_client));
+    if(!client) {
+        close(fd);
+        return NULL;
+    }
+    *client = (struct xsort_client){ .fd = fd, .batch = malloc(CLIENT_BATCH_BYTES), .batchLen = 5, .batchCap = CLIENT_BATCH_BYTES };
+    if(!client->batch) {
+        close(fd);
+        free(client);
+        return NULL;
+    }
+    return client;
+}
+
+int xsort_client_compare_batch(struct xsort_client *client, const uint32_t *pairs, uint32_t count, uint8_t *results) {
+    // larger batches go out as several frames, one round trip each
+    do {
+        uint32_t chunk = count < CLIENT_MAX_COMPARES ? count : CLIENT_MAX_COMPARES;
+        for(uint32_t k = 0; k < chunk; k++) {
+            if(append_op(client, XSORT_OP_COMPARE, pairs[2 * k], pairs[2 * k + 1]) != 0) {
+                return -1;
+            }
+        }
+        if(flush(client) != 0) {
+            return -1;
+        }
+        if(chunk == 0) {
+            return 0;
+        }
+        uint8_t header[4];
+        if(!recv_all(client->fd, header, sizeof(header)) || get_u32(header) != chunk || !recv_all(client->fd, results, chunk)) {
+            client->broken = true;
+            return -1;
+        }
+        pairs += 2 * chunk;
+        results += chunk;
+        count -= chunk;
+    } while(count > 0);
+    return 0;
+}
+
+int xsort_client_compare(struct xsort_client *client, uint32_t i, uint32_t j) {
+    uint32_t pair[2] = { i, j };
+    uint8_t result;
+    if(xsort_client_compare_batch(client, pair, 1, &result) != 0) {
+        return -1;
+    }
+    return result;
+}
+
+int xsort_client_swap(struct xsort_client *client, uint32_t i, uint32_t j) {
+    if(append_op(client, XSORT_OP_SWAP, i, j) != 0) {
+        return -1;
+    }
+    if(client->batchLen >= CLIENT_BATCH_BYTES) {
+        return flush(client);
+    }
+    return 0;
+}
+
+int xsort_client_finish(struct xsort_client *client) {
+    int result = -1;
+    if(!client->broken && reserve(client, 1)) {
+        client->batch[client->batchLen++] = XSORT_OP_FINISH;
+        result = flush(client);
+    }
+    close(client->fd);
+    free(client->batch);
+    free(client);
+    return result;
+}
@@ -0,0 +1,18 @@
+// Client library for driving an xsort renderer over the socket opened by "xsort --listen PATH".
+// The wire format is documented in xsort_protocol.h.
+// Swaps are buffered and sent in batches, compares flush the batch and wait for the answer.
+// Functions returning int return -1 once the connection is lost, e.g. when the window was closed.
+#include <stdint.h>
+
+struct xsort_client;
+
+// returns NULL with errno set on failure, EMSGSIZE when the HELLO frame holding name and values
+// would exceed XSORT_MAX_FRAME
+struct xsort_client *xsort_client_connect(const char *path, const char *name, const int64_t *values, uint32_t count);
+int xsort_client_compare(struct xsort_client *client, uint32_t i, uint32_t j);
+// runs count independent compares in one round trip, pairs holds count (i, j) index pairs
+// batches that would exceed XSORT_MAX_FRAME are split into several frames and round trips
+int xsort_client_compare_batch(struct xsort_client *client, const uint32_t *pairs, uint32_t count, uint8_t *results);
+int xsort_client_swap(struct xsort_client *client, uint32_t i, uint32_t j);
+// sends the pending swaps and FINISH, then closes the connection and frees the client
+int xsort_client_finish(struct xsort_client *client);
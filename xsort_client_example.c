@@ -0,0 +1,65 @@
+// Example external algorithm: odd-even transposition sort driven over the xsort socket.
+// Each phase compares disjoint neighbour pairs, so all of its compares go out in one batch.
+// usage: xsort_client_example [SOCKET_PATH [COUNT]]
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+
+#include "xsort_client.h"
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "xsort.sock";
+    uint32_t count = argc > 2 ? (uint32_t)atoi(argv[2]) : 16;
+    if(count == 0) {
+        fprintf(stderr, "Invalid count\n");
+        return 1;
+    }
+    int64_t *values = malloc(count * sizeof(int64_t));
+    uint32_t *pairs = malloc(count * sizeof(uint32_t));
+    uint8_t *results = malloc(count);
+    if(!values || !pairs || !results) {
+        perror("malloc");
+        return 1;
+    }
+    srand(time(NULL));
+    for(uint32_t i = 0; i < count; i++) {
+        values[i] = rand() % 100;
+    }
+
+    struct xsort_client *client = xsort_client_connect(path, "Odd-Even Transposition (external)", values, count);
+    if(!client) {
+        fprintf(stderr, "Failed to connect to %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    for(uint32_t phase = 0; phase < count; phase++) {
+        uint32_t pairsLen = 0;
+        for(uint32_t i = phase % 2; i + 1 < count; i += 2) {
+            // is values[i + 1] < values[i]?
+            pairs[2 * pairsLen] = i + 1;
+            pairs[2 * pairsLen + 1] = i;
+            pairsLen++;
+        }
+        if(xsort_client_compare_batch(client, pairs, pairsLen, results) != 0) {
+            fprintf(stderr, "Connection lost\n");
+            return 1;
+        }
+        for(uint32_t k = 0; k < pairsLen; k++) {
+            if(results[k]) {
+                xsort_client_swap(client, pairs[2 * k + 1], pairs[2 * k]);
+            }
+        }
+    }
+    if(xsort_client_finish(client) != 0) {
+        fprintf(stderr, "Connection lost\n");
+        return 1;
+    }
+    free(values);
+    free(pairs);
+    free(results);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "xsort_subproc.h"
+#include "xsort_cost.h"
+
+// rough numbers for 8-byte keys on a current desktop core
+const struct cost_model cost_model_default = {
+    .compareNs = 1.0,
+    .readNs = 1.0,
+    .swapNs = 1.0,
+    .swapByteNs = 0.05,
+    .lineBytes = 64,
+    .cacheBytes = 32 << 10,
+    .nearMissNs = 4.0,
+    .farMissNs = 80.0,
+};
+
+bool cost_load(const char *path, struct cost_model *model) {
+    *model = cost_model_default;
+    FILE *f = fopen(path, "r");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    const struct {
+        const char *key;
+        double *value;
+        int *intValue;
+    } params[] = {
+        { "compare_ns", &model->compareNs, NULL },
+        { "read_ns", &model->readNs, NULL },
+        { "swap_ns", &model->swapNs, NULL },
+        { "swap_byte_ns", &model->swapByteNs, NULL },
+        { "line_bytes", NULL, &model->lineBytes },
+        { "cache_bytes", NULL, &model->cacheBytes },
+        { "near_miss_ns", &model->nearMissNs, NULL },
+        { "far_miss_ns", &model->farMissNs, NULL },
+    };
+    const int paramsLen = sizeof(params) / sizeof(params[0]);
+    char line[256];
+    int lineNr = 0;
+    bool ok = true;
+    while(fgets(line, sizeof(line), f)) {
+        lineNr++;
+        char key[64];
+        double value;
+        if(line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if(sscanf(line, " %63[a-z_] = %lf", key, &value) != 2 || value < 0) {
+            fprintf(stderr, "%s:%d: expected \"key = value\" with a value >= 0\n", path, lineNr);
+            ok = false;
+            continue;
+        }
+        int i;
+        for(i = 0; i < paramsLen && strcmp(params[i].key, key) != 0; i++);
+        if(i == paramsLen) {
+            fprintf(stderr, "%s:%d: unknown setting \"%s\"\n", path, lineNr, key);
+            ok = false;
+            continue;
+        }
+        if(params[i].value) {
+            *params[i].value = value;
+        } else {
+            *params[i].intValue = (int)value;
+        }
+    }
+    fclose(f);
+    if(model->lineBytes < 1 || model->cacheBytes < model->lineBytes) {
+        fprintf(stderr, "%s: need 1 <= line_bytes <= cache_bytes\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+void cost_print(FILE *out, const struct cost_model *model) {
+    fprintf(out, "compare_ns = %g\nread_ns = %g\nswap_ns = %g\nswap_byte_ns = %g\n", model->compareNs, model->readNs, model->swapNs, model->swapByteNs);
+    fprintf(out, "line_bytes = %d\ncache_bytes = %d\nnear_miss_ns = %g\nfar_miss_ns = %g\n", model->lineBytes, model->cacheBytes, model->nearMissNs, model->farMissNs);
+}
+
+struct cache_state {
+    const struct cost_model *model;
+    int64_t last[2];
+    struct cost_estimate *estimate;
+};
+
+static void cache_access(struct cache_state *c, int64_t addr) {
+    int64_t d0 = addr > c->last[0] ? addr - c->last[0] : c->last[0] - addr;
+    int64_t d1 = addr > c->last[1] ? addr - c->last[1] : c->last[1] - addr;
+    int64_t distance = d0 < d1 ? d0 : d1;
+    if(distance >= c->model->cacheBytes) {
+        c->estimate->missNs += c->model->farMissNs;
+        c->estimate->farMisses++;
+    } else if(distance >= c->model->lineBytes) {
+        c->estimate->missNs += c->model->nearMissNs;
+        c->estimate->nearMisses++;
+    }
+    if(d0 != 0) {
+        c->last[1] = c->last[0];
+        c->last[0] = addr;
+    }
+}
+
+void cost_estimate(const struct cost_model *model, const struct sort_op_log *log, int64_t len, size_t elemSize, bool indirect, struct cost_estimate *estimate) {
+    *estimate = (struct cost_estimate){0};
+    struct cache_state cache = { model, { 0, 0 }, estimate };
+    // indirect sorts compare the records where they are, and swap entries of an index placed after them
+    int64_t *index = NULL;
+    int64_t indexBase = (int64_t)len * elemSize;
+    size_t moved = elemSize;
+    if(indirect) {
+        index = malloc((len ? len : 1) * sizeof(int64_t));
+        if(!index) {
+            perror("malloc");
+            exit(1);
+        }
+        for(int64_t i = 0; i < len; i++) {
+            index[i] = i;
+        }
+        moved = sizeof(int64_t);
+    }
+    for(int64_t op = 0; op < log->len; op++) {
+        const struct sort_op *o = &log->ops[op];
+        switch(o->kind) {
+            case SORT_OP_COMPARE:
+            case SORT_OP_READ:
+                if(o->kind == SORT_OP_COMPARE) {
+                    estimate->compareNs += model->compareNs;
+                } else {
+                    estimate->readNs += model->readNs;
+                }
+                if(indirect) {
+                    cache_access(&cache, indexBase + (int64_t)o->i * sizeof(int64_t));
+                    cache_access(&cache, (int64_t)index[o->i] * elemSize);
+                    if(o->kind == SORT_OP_COMPARE) {
+                        cache_access(&cache, indexBase + (int64_t)o->j * sizeof(int64_t));
+                        cache_access(&cache, (int64_t)index[o->j] * elemSize);
+                    }
+                } else {
+                    cache_access(&cache, (int64_t)o->i * elemSize);
+                    if(o->kind == SORT_OP_COMPARE) {
+                        cache_access(&cache, (int64_t)o->j * elemSize);
+                    }
+                }
+                break;
+            case SORT_OP_SWAP:
+                estimate->swapNs += model->swapNs + 3 * moved * model->swapByteNs;
+                if(indirect) {
+                    cache_access(&cache, indexBase + (int64_t)o->i * sizeof(int64_t));
+                    cache_access(&cache, indexBase + (int64_t)o->j * sizeof(int64_t));
+                    int64_t tmp = index[o->i];
+                    index[o->i] = index[o->j];
+                    index[o->j] = tmp;
+                } else {
+                    cache_access(&cache, (int64_t)o->i * elemSize);
+                    cache_access(&cache, (int64_t)o->j * elemSize);
+                }
+                break;
+        }
+    }
+    if(indirect) {
+        // elem_settle moves every misplaced record once, from wherever the index points
+        for(int64_t i = 0; i < len; i++) {
+            if(index[i] != i) {
+                estimate->settleNs += elemSize * model->swapByteNs + model->farMissNs;
+            }
+        }
+        free(index);
+    }
+}
+
+double cost_total(const struct cost_estimate *estimate) {
+    return estimate->compareNs + estimate->readNs + estimate->swapNs + estimate->missNs + estimate->settleNs;
+}
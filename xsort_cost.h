@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct sort_op_log;
+
+// estimated cost of the requests of an algorithm, so expensive keys and large records can be
+// simulated on recorded op streams instead of counting every compare and swap the same
+struct cost_model {
+    double compareNs;
+    double readNs;
+    // a swap costs swapNs plus swapByteNs for every byte moved, three elements through a temporary
+    double swapNs;
+    double swapByteNs;
+    // an access within lineBytes of one of the two previous accesses is free, within cacheBytes it
+    // costs nearMissNs and farther away farMissNs; two because most algorithms walk two cursors
+    int lineBytes;
+    int cacheBytes;
+    double nearMissNs;
+    double farMissNs;
+};
+extern const struct cost_model cost_model_default;
+
+struct cost_estimate {
+    double compareNs, readNs, swapNs, missNs;
+    // moving the records into place after an indirect sort
+    double settleNs;
+    int64_t nearMisses, farMisses;
+};
+
+// reads "key = value" lines like the tuning file, starting from the defaults
+bool cost_load(const char *path, struct cost_model *model);
+void cost_print(FILE *out, const struct cost_model *model);
+// replays log for len elements of elemSize bytes, through an index when indirect is set
+void cost_estimate(const struct cost_model *model, const struct sort_op_log *log, int64_t len, size_t elemSize, bool indirect, struct cost_estimate *estimate);
+double cost_total(const struct cost_estimate *estimate);
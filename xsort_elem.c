@@ -0,0 +1,258 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "utils.h"
+#include "xsort_elem.h"
+
+struct elem_str8 { char s[8]; };
+struct elem_str32 { char s[32]; };
+// the key comes first in every record, the generic code below relies on it
+struct elem_rec16 { int64_t key; char payload[8]; };
+struct elem_rec64 { int64_t key; char payload[56]; };
+struct elem_rec256 { int64_t key; char payload[248]; };
+struct elem_rec1024 { int64_t key; char payload[1016]; };
+
+#define LESS_VALUE(a, b) (*(a) < *(b))
+#define LESS_STRING(a, b) (memcmp((a)->s, (b)->s, sizeof((a)->s)) < 0)
+#define LESS_KEY(a, b) ((a)->key < (b)->key)
+
+// compare and swap kernels for element type T, so the element size is a compile-time constant
+// and the int64 swap stays three register moves instead of a memcpy of a runtime size
+// indirect buffers compare through the index and only swap the index entries
+#define ELEM_KERNELS(NAME, T, LESS)                                                 \
+    static int NAME##_smaller(const struct elem_buf *eb, int64_t i, int64_t j) {    \
+        const T *d = (const T *)eb->data;                                           \
+        if(eb->index) {                                                             \
+            return LESS(&d[eb->index[i]], &d[eb->index[j]]);                        \
+        }                                                                           \
+        return LESS(&d[i], &d[j]);                                                  \
+    }                                                                               \
+    static inline void NAME##_swap_inline(struct elem_buf *eb, int64_t i, int64_t j) {\
+        if(eb->index) {                                                             \
+            int64_t tmp = eb->index[i];                                             \
+            eb->index[i] = eb->index[j];                                            \
+            eb->index[j] = tmp;                                                     \
+            return;                                                                 \
+        }                                                                           \
+        T *d = (T *)eb->data;                                                       \
+        T tmp = d[i];                                                               \
+        d[i] = d[j];                                                                \
+        d[j] = tmp;                                                                 \
+    }                                                                               \
+    static void NAME##_swap(struct elem_buf *eb, int64_t i, int64_t j) {            \
+        NAME##_swap_inline(eb, i, j);                                               \
+        eb->bytesMoved += 3 * (eb->index ? sizeof(int64_t) : sizeof(T));            \
+    }                                                                               \
+    static void NAME##_replay(struct elem_buf *eb, const int64_t *swaps, int64_t swapsLen) { \
+        for(int64_t k = 0; k < swapsLen; k++) {                                     \
+            NAME##_swap_inline(eb, swaps[2 * k], swaps[2 * k + 1]);                 \
+        }                                                                           \
+        eb->bytesMoved += (uint64_t)swapsLen * 3 * (eb->index ? sizeof(int64_t) : sizeof(T)); \
+    }
+
+ELEM_KERNELS(int64, int64_t, LESS_VALUE)
+ELEM_KERNELS(double, double, LESS_VALUE)
+ELEM_KERNELS(str8, struct elem_str8, LESS_STRING)
+ELEM_KERNELS(str32, struct elem_str32, LESS_STRING)
+ELEM_KERNELS(rec16, struct elem_rec16, LESS_KEY)
+ELEM_KERNELS(rec64, struct elem_rec64, LESS_KEY)
+ELEM_KERNELS(rec256, struct elem_rec256, LESS_KEY)
+ELEM_KERNELS(rec1024, struct elem_rec1024, LESS_KEY)
+
+#define ELEM_TYPE(NAME, LABEL, KIND, T, INDIRECT) \
+    { LABEL, KIND, sizeof(T), INDIRECT, NAME##_smaller, NAME##_swap, NAME##_replay }
+
+// records of 256 bytes and more are sorted through an index by default
+// the -copy variants move them anyway, to compare the cost
+const struct elem_type elem_types[ELEM_TYPES_LEN] = {
+    ELEM_TYPE(int64, "int64", ELEM_INT64, int64_t, false),
+    ELEM_TYPE(double, "double", ELEM_DOUBLE, double, false),
+    ELEM_TYPE(str8, "str8", ELEM_STRING, struct elem_str8, false),
+    ELEM_TYPE(str32, "str32", ELEM_STRING, struct elem_str32, false),
+    ELEM_TYPE(rec16, "rec16", ELEM_RECORD, struct elem_rec16, false),
+    ELEM_TYPE(rec64, "rec64", ELEM_RECORD, struct elem_rec64, false),
+    ELEM_TYPE(rec256, "rec256-copy", ELEM_RECORD, struct elem_rec256, false),
+    ELEM_TYPE(rec256, "rec256", ELEM_RECORD, struct elem_rec256, true),
+    ELEM_TYPE(rec1024, "rec1024-copy", ELEM_RECORD, struct elem_rec1024, false),
+    ELEM_TYPE(rec1024, "rec1024", ELEM_RECORD, struct elem_rec1024, true),
+};
+
+int elem_type_find(const char *name) {
+    for(int type = 0; type < ELEM_TYPES_LEN; type++) {
+        if(strcmp(elem_types[type].name, name) == 0) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+static const char *elem_at(const struct elem_buf *eb, int64_t i) {
+    return eb->data + (size_t)(eb->index ? eb->index[i] : i) * eb->type->size;
+}
+
+void elem_buf_init(struct elem_buf *eb, int type, const int64_t *values, int64_t len) {
+    const struct elem_type *t = &elem_types[type];
+    *eb = (struct elem_buf){ .type = t, .len = len };
+    eb->data = calloc(len ? len : 1, t->size);
+    if(!eb->data) {
+        perror("calloc");
+        exit(1);
+    }
+    for(int64_t i = 0; i < len; i++) {
+        char *p = eb->data + (size_t)i * t->size;
+        switch(t->kind) {
+            case ELEM_INT64:
+                memcpy(p, &values[i], sizeof(int64_t));
+                break;
+            case ELEM_DOUBLE: {
+                double d = values[i] / 2.0;
+                memcpy(p, &d, sizeof(double));
+                break;
+            }
+            case ELEM_STRING: {
+                // fixed width, longer numbers are cut off and shorter ones padded with zero bytes
+                char str[32];
+                int strLen = sprintf(str, "%" PRId64, values[i]);
+                memcpy(p, str, (size_t)strLen < t->size ? (size_t)strLen : t->size);
+                break;
+            }
+            case ELEM_RECORD:
+                memcpy(p, &values[i], sizeof(int64_t));
+                memset(p + sizeof(int64_t), i & 0xff, t->size - sizeof(int64_t));
+                break;
+        }
+    }
+    if(t->indirect) {
+        eb->index = malloc_((len ? len : 1) * sizeof(int64_t));
+        for(int64_t i = 0; i < len; i++) {
+            eb->index[i] = i;
+        }
+    }
+}
+
+void elem_buf_wrap(struct elem_buf *eb, int64_t *buf, int64_t len) {
+    *eb = (struct elem_buf){ .type = &elem_types[ELEM_INT64_TYPE], .len = len, .data = (char *)buf, .wrapped = true };
+}
+
+void elem_buf_copy(struct elem_buf *dst, const struct elem_buf *src) {
+    size_t bytes = (size_t)(src->len ? src->len : 1) * src->type->size;
+    *dst = (struct elem_buf){ .type = src->type, .len = src->len, .data = malloc_(bytes) };
+    memcpy(dst->data, src->data, bytes);
+    if(src->index) {
+        dst->index = malloc_((src->len ? src->len : 1) * sizeof(int64_t));
+        memcpy(dst->index, src->index, src->len * sizeof(int64_t));
+    }
+}
+
+void elem_buf_free(struct elem_buf *eb) {
+    if(!eb->wrapped) {
+        free(eb->data);
+    }
+    free(eb->index);
+    eb->data = NULL;
+    eb->index = NULL;
+}
+
+struct str_rank {
+    const char *s;
+    size_t size;
+    int64_t i;
+};
+
+static int compare_str_rank(const void *a, const void *b) {
+    const struct str_rank *x = a, *y = b;
+    return memcmp(x->s, y->s, x->size);
+}
+
+void elem_keys(const struct elem_buf *eb, int64_t *keys) {
+    if(eb->type->kind == ELEM_STRING) {
+        struct str_rank *ranks = malloc_((eb->len ? eb->len : 1) * sizeof(struct str_rank));
+        for(int64_t i = 0; i < eb->len; i++) {
+            ranks[i] = (struct str_rank){ elem_at(eb, i), eb->type->size, i };
+        }
+        qsort(ranks, eb->len, sizeof(struct str_rank), compare_str_rank);
+        int64_t rank = 0;
+        for(int64_t i = 0; i < eb->len; i++) {
+            if(i > 0 && compare_str_rank(&ranks[i - 1], &ranks[i]) != 0) {
+                rank++;
+            }
+            keys[ranks[i].i] = rank;
+        }
+        free(ranks);
+        return;
+    }
+    for(int64_t i = 0; i < eb->len; i++) {
+        const char *p = elem_at(eb, i);
+        if(eb->type->kind == ELEM_DOUBLE) {
+            // flipping the magnitude bits of negative numbers makes the bit pattern compare like the double
+            int64_t bits;
+            memcpy(&bits, p, sizeof(int64_t));
+            keys[i] = bits < 0 ? bits ^ INT64_MAX : bits;
+        } else {
+            // int64 and the record key
+            memcpy(&keys[i], p, sizeof(int64_t));
+        }
+    }
+}
+
+int elem_format(const struct elem_buf *eb, int64_t i, char *str, size_t len) {
+    const char *p = elem_at(eb, i);
+    switch(eb->type->kind) {
+        case ELEM_DOUBLE: {
+            double d;
+            memcpy(&d, p, sizeof(double));
+            return snprintf(str, len, "%g", d);
+        }
+        case ELEM_STRING:
+            return snprintf(str, len, "%.*s", (int)strnlen(p, eb->type->size), p);
+        case ELEM_INT64:
+        case ELEM_RECORD:
+            break;
+    }
+    int64_t key;
+    memcpy(&key, p, sizeof(int64_t));
+    return snprintf(str, len, "%" PRId64, key);
+}
+
+void elem_settle(struct elem_buf *eb) {
+    if(!eb->index) {
+        return;
+    }
+    size_t size = eb->type->size;
+    char *tmp = malloc_(size);
+    for(int64_t start = 0; start < eb->len; start++) {
+        if(eb->index[start] == start) {
+            continue;
+        }
+        // follow the cycle through start, pulling each record into the place that wants it
+        memcpy(tmp, eb->data + start * size, size);
+        int64_t pos = start;
+        while(eb->index[pos] != start) {
+            int64_t from = eb->index[pos];
+            memcpy(eb->data + pos * size, eb->data + from * size, size);
+            eb->index[pos] = pos;
+            pos = from;
+            eb->bytesMoved += size;
+        }
+        memcpy(eb->data + pos * size, tmp, size);
+        eb->index[pos] = pos;
+        eb->bytesMoved += 2 * size;
+    }
+    free(tmp);
+    free(eb->index);
+    eb->index = NULL;
+}
+
+bool elem_sorted(const struct elem_buf *eb) {
+    for(int64_t i = 0; i + 1 < eb->len; i++) {
+        if(elem_smaller(eb, i + 1, i)) {
+            return false;
+        }
+    }
+    return true;
+}
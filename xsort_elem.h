@@ -0,0 +1,68 @@
+#ifndef XSORT_ELEM_H
+#define XSORT_ELEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// element types the renderer can sort, chosen at runtime
+// every type is built from the int64 edit buffer, so the same numbers can be sorted as any of them
+enum elem_kind { ELEM_INT64, ELEM_DOUBLE, ELEM_STRING, ELEM_RECORD };
+
+struct elem_buf;
+
+struct elem_type {
+    const char *name;
+    enum elem_kind kind;
+    size_t size;
+    // sorted through an index array, the records are moved into place once by elem_settle
+    bool indirect;
+    // compare and swap are specialized per type, see ELEM_KERNELS in xsort_elem.c
+    int (*smaller)(const struct elem_buf *eb, int64_t i, int64_t j);
+    void (*swap)(struct elem_buf *eb, int64_t i, int64_t j);
+    // applies swapsLen (i, j) pairs in a loop with the swap inlined
+    void (*replay)(struct elem_buf *eb, const int64_t *swaps, int64_t swapsLen);
+};
+
+struct elem_buf {
+    const struct elem_type *type;
+    int64_t len;
+    char *data;
+    // position -> record, only for indirect types until elem_settle
+    int64_t *index;
+    uint64_t bytesMoved;
+    // data is owned by the caller, see elem_buf_wrap
+    bool wrapped;
+};
+
+extern const struct elem_type elem_types[];
+#define ELEM_TYPES_LEN 10
+#define ELEM_INT64_TYPE 0
+
+// index into elem_types, or -1
+int elem_type_find(const char *name);
+// double: v / 2, strings: the decimal digits of v (so "10" < "9"), records: key v and a payload tagged with i
+void elem_buf_init(struct elem_buf *eb, int type, const int64_t *values, int64_t len);
+// int64 view of buf without copying, swaps go straight to buf
+void elem_buf_wrap(struct elem_buf *eb, int64_t *buf, int64_t len);
+void elem_buf_copy(struct elem_buf *dst, const struct elem_buf *src);
+void elem_buf_free(struct elem_buf *eb);
+
+static inline int elem_smaller(const struct elem_buf *eb, int64_t i, int64_t j) {
+    return eb->type->smaller(eb, i, j);
+}
+
+static inline void elem_swap(struct elem_buf *eb, int64_t i, int64_t j) {
+    eb->type->swap(eb, i, j);
+}
+
+// order-preserving int64 image of every element, used for the metrics and the READ request
+// strings have no such image of their own and get their rank instead
+void elem_keys(const struct elem_buf *eb, int64_t *keys);
+// sphere label, returns its length
+int elem_format(const struct elem_buf *eb, int64_t i, char *str, size_t len);
+// moves the records of an indirect buffer into index order, every record moves at most once
+void elem_settle(struct elem_buf *eb);
+bool elem_sorted(const struct elem_buf *eb);
+
+#endif
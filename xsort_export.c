@@ -0,0 +1,413 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "xsort_subproc.h"
+#include "xsort_anim.h"
+#include "xsort_export.h"
+
+// the live renderer draws at 60 frames per second, so does the video
+#define EXPORT_FPS 60
+// frames rendered by a thread in one go, a checkpoint is saved at the start of each chunk
+#define EXPORT_CHUNK 128
+// digits are drawn from a 3x5 bitmap font, scaled up
+#define GLYPH_SCALE 2
+#define GLYPH_ADVANCE (4 * GLYPH_SCALE)
+#define GLYPH_HEIGHT (5 * GLYPH_SCALE)
+// below the spheres: the swap counter and a progress bar
+#define STATUS_HEIGHT 24
+
+// rows of '0'-'9', '-' and '/', 3 bits per row, most significant bit on the left
+static const uint8_t glyphs[12][5] = {
+    { 7, 5, 5, 5, 7 }, { 2, 6, 2, 2, 7 }, { 7, 1, 7, 4, 7 }, { 7, 1, 7, 1, 7 },
+    { 5, 5, 7, 1, 1 }, { 7, 4, 7, 1, 7 }, { 7, 4, 7, 5, 7 }, { 7, 1, 1, 1, 1 },
+    { 7, 5, 7, 5, 7 }, { 7, 5, 7, 1, 7 }, { 0, 0, 7, 0, 0 }, { 1, 1, 2, 4, 4 },
+};
+
+// the state the live animation loop carries from one frame to the next
+struct export_cursor {
+    struct animation_state anim;
+    int focusX;
+    int64_t swapsDone;
+};
+
+struct export_ctx {
+    const int64_t *input;
+    int bufLen;
+    const int64_t *swaps;
+    int64_t swapsLen;
+    int speed;
+    int verticalDuration, horizontalDuration;
+    int radius;
+    int viewportHeight;
+    int fullWidth;
+    int width, height;
+    int64_t frames;
+    // cursor before frame i * EXPORT_CHUNK
+    struct export_cursor *checkpoints;
+    int64_t checkpointsLen;
+    // Y4M output, or -1 when writing one PPM per frame into ppmDir
+    int fd;
+    size_t headerLen;
+    const char *ppmDir;
+    pthread_mutex_t lock;
+    int64_t nextChunk;
+};
+
+static int text_width(int64_t nr) {
+    char str[32];
+    return sprintf(str, "%" PRId64, nr) * GLYPH_ADVANCE - GLYPH_SCALE;
+}
+
+static void draw_text(const struct export_ctx *ctx, uint8_t *fb, int x, int y, const char *str) {
+    for(; *str; str++, x += GLYPH_ADVANCE) {
+        const uint8_t *glyph = glyphs[*str == '-' ? 10 : *str == '/' ? 11 : *str - '0'];
+        for(int row = 0; row < 5 * GLYPH_SCALE; row++) {
+            for(int col = 0; col < 3 * GLYPH_SCALE; col++) {
+                int px = x + col, py = y + row;
+                if(px < 0 || px >= ctx->width || py < 0 || py >= ctx->height) {
+                    continue;
+                }
+                if(glyph[row / GLYPH_SCALE] & (4 >> (col / GLYPH_SCALE))) {
+                    fb[py * ctx->width + px] = 0;
+                }
+            }
+        }
+    }
+}
+
+static void draw_num_sphere(const struct export_ctx *ctx, uint8_t *fb, int centerX, int centerY, int64_t nr) {
+    // same layout as the live renderer: a circle with the number centered in it
+    int r = ctx->radius;
+    int inner = (r - 1) * (r - 1), outer = r * r + r;
+    int y0 = i_max(0, centerY - r - 1), y1 = i_min(ctx->height - 1, centerY + r + 1);
+    int x0 = i_max(0, centerX - r - 1), x1 = i_min(ctx->width - 1, centerX + r + 1);
+    for(int y = y0; y <= y1; y++) {
+        for(int x = x0; x <= x1; x++) {
+            int d = (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY);
+            if(d >= inner && d <= outer) {
+                fb[y * ctx->width + x] = 0;
+            }
+        }
+    }
+    char str[32];
+    sprintf(str, "%" PRId64, nr);
+    draw_text(ctx, fb, centerX - text_width(nr) / 2, centerY - GLYPH_HEIGHT / 2, str);
+}
+
+static bool export_step(const struct export_ctx *ctx, struct export_cursor *c) {
+    // one frame of the animation loop in run_sort_fds, without the drawing
+    // returns false once the last swap is done
+    struct animation_state *anim = &c->anim;
+    if(anim->progress >= anim->end + 1) {
+        if(anim->sphereIdx1 != -1) {
+            anim->x = anim->targetX;
+            anim->y = anim->targetY;
+        }
+        if(anim->state == DOWN_2) {
+            if(anim->sphereIdx1 != -1) {
+                c->swapsDone++;
+            }
+            if(c->swapsDone == ctx->swapsLen) {
+                *anim = (struct animation_state){ .sphereIdx1 = -1, .sphereIdx2 = -1, .state = DOWN_2 };
+                return false;
+            }
+            *anim = (struct animation_state){ .sphereIdx1 = ctx->swaps[2 * c->swapsDone], .sphereIdx2 = ctx->swaps[2 * c->swapsDone + 1], .state = INIT };
+        }
+        int horizontalDuration = anim_horizontal_duration(ctx->horizontalDuration, abs(anim->sphereIdx2 - anim->sphereIdx1));
+        anim_next_phase(anim, ctx->radius, ctx->viewportHeight, ctx->verticalDuration, horizontalDuration);
+    }
+    update_anim_position(anim);
+    c->focusX = anim_follow(c->focusX, anim->x, ctx->width);
+    int widthDiff = i_max(0, ctx->fullWidth - ctx->width);
+    c->focusX = i_max(ctx->fullWidth / 2 - widthDiff / 2, i_min(c->focusX, ctx->fullWidth / 2 + widthDiff / 2));
+    anim->progress += ctx->speed;
+    return true;
+}
+
+static void render_frame(const struct export_ctx *ctx, const struct export_cursor *c, const int64_t *buf, uint8_t *fb) {
+    // buf is the buffer after c->swapsDone swaps, the running swap is only applied once its animation is over
+    memset(fb, 255, (size_t)ctx->width * ctx->height);
+    const struct animation_state *anim = &c->anim;
+    int left = c->focusX - ctx->width / 2;
+    int mid = ctx->viewportHeight / 2;
+    int step = ctx->radius * 2 + 10;
+    int first = i_max(0, left / step - 1), last = i_min(ctx->bufLen - 1, (left + ctx->width) / step + 1);
+    for(int i = first; i <= last; i++) {
+        if(i != anim->sphereIdx1 && i != anim->sphereIdx2) {
+            draw_num_sphere(ctx, fb, sphere_x(ctx->radius, i) - left, mid, buf[i]);
+        }
+    }
+    if(anim->sphereIdx1 != -1) {
+        // the sphere that is not moving waits at the place of sphere 2, in the row, below or above it
+        int restX = sphere_x(ctx->radius, anim->sphereIdx2) - left;
+        switch(anim->state) {
+            case DOWN_1:
+            case RIGHT_1:
+                draw_num_sphere(ctx, fb, restX, mid, buf[anim->sphereIdx2]);
+                break;
+            case UP_2:
+                draw_num_sphere(ctx, fb, restX, mid + step, buf[anim->sphereIdx1]);
+                break;
+            case UP_1:
+                draw_num_sphere(ctx, fb, restX, mid - step, buf[anim->sphereIdx2]);
+                break;
+            case LEFT_2:
+            case DOWN_2:
+                draw_num_sphere(ctx, fb, restX, mid, buf[anim->sphereIdx1]);
+                break;
+            case INIT:
+                break;
+        }
+        draw_num_sphere(ctx, fb, anim->x - left, anim->y, buf[get_anim_idx(anim)]);
+    }
+
+    char status[64];
+    snprintf(status, sizeof(status), "%" PRId64 "/%" PRId64, c->swapsDone, ctx->swapsLen);
+    draw_text(ctx, fb, 5, ctx->viewportHeight + 3, status);
+    int barY = ctx->viewportHeight + 8 + GLYPH_HEIGHT;
+    int done = ctx->swapsLen ? (int)(ctx->width * c->swapsDone / ctx->swapsLen) : ctx->width;
+    for(int y = barY; y < barY + 5 && y < ctx->height; y++) {
+        memset(fb + y * ctx->width, 0, done);
+        memset(fb + y * ctx->width + done, 200, ctx->width - done);
+    }
+}
+
+static void pwrite_all(int fd, const uint8_t *buf, size_t len, off_t offset) {
+    while(len > 0) {
+        ssize_t bytes = pwrite(fd, buf, len, offset);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("pwrite");
+            exit(1);
+        }
+        buf += bytes;
+        len -= bytes;
+        offset += bytes;
+    }
+}
+
+static void write_ppm(const struct export_ctx *ctx, const uint8_t *fb, uint8_t *rgb, int64_t frame) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/frame_%06" PRId64 ".ppm", ctx->ppmDir, frame);
+    size_t pixels = (size_t)ctx->width * ctx->height;
+    for(size_t i = 0; i < pixels; i++) {
+        rgb[3 * i] = rgb[3 * i + 1] = rgb[3 * i + 2] = fb[i];
+    }
+    FILE *file = fopen(path, "wb");
+    if(!file) {
+        perror("fopen");
+        exit(1);
+    }
+    fprintf(file, "P6\n%d %d\n255\n", ctx->width, ctx->height);
+    if(fwrite(rgb, 3, pixels, file) != pixels || fclose(file) != 0) {
+        perror(path);
+        exit(1);
+    }
+}
+
+static void *render_thread(void *arg) {
+    struct export_ctx *ctx = arg;
+    size_t pixels = (size_t)ctx->width * ctx->height;
+    // one Y4M frame: the FRAME marker, the luma plane this renders into, then neutral chroma
+    size_t frameSize = 6 + pixels + pixels / 2;
+    uint8_t *frame = malloc_(frameSize);
+    memcpy(frame, "FRAME\n", 6);
+    memset(frame + 6 + pixels, 128, pixels / 2);
+    uint8_t *rgb = ctx->fd < 0 ? malloc_(pixels * 3) : NULL;
+    int64_t *buf = malloc_(ctx->bufLen * sizeof(int64_t));
+    memcpy(buf, ctx->input, ctx->bufLen * sizeof(int64_t));
+    // chunks are handed out in increasing order, so the swaps applied to buf only ever move forward
+    int64_t applied = 0;
+
+    for(;;) {
+        pthread_mutex_lock(&ctx->lock);
+        int64_t chunk = ctx->nextChunk++;
+        pthread_mutex_unlock(&ctx->lock);
+        if(chunk >= ctx->checkpointsLen) {
+            break;
+        }
+        struct export_cursor cursor = ctx->checkpoints[chunk];
+        int64_t end = (chunk + 1) * EXPORT_CHUNK < ctx->frames ? (chunk + 1) * EXPORT_CHUNK : ctx->frames;
+        for(int64_t f = chunk * EXPORT_CHUNK; f < end; f++) {
+            export_step(ctx, &cursor);
+            for(; applied < cursor.swapsDone; applied++) {
+                int64_t i = ctx->swaps[2 * applied], j = ctx->swaps[2 * applied + 1];
+                int64_t tmp = buf[i];
+                buf[i] = buf[j];
+                buf[j] = tmp;
+            }
+            render_frame(ctx, &cursor, buf, frame + 6);
+            if(ctx->fd >= 0) {
+                pwrite_all(ctx->fd, frame, frameSize, ctx->headerLen + f * frameSize);
+            } else {
+                write_ppm(ctx, frame + 6, rgb, f);
+            }
+        }
+    }
+    free(frame);
+    free(rgb);
+    free(buf);
+    return NULL;
+}
+
+int export_main(int argc, char **argv) {
+    // usage: xsort --export [--algo NAME] [--k K] [--speed N] [--threads N] [--ppm DIR | --out FILE.y4m] [INPUT]
+    const char *algoName = "Quick Sort";
+    const char *input = "xsort_buf.txt";
+    const char *out = "xsort.y4m";
+    const char *ppmDir = NULL;
+    int64_t k = 1;
+    int speed = 20;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool haveInput = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--algo") == 0 && i + 1 < argc) {
+            algoName = argv[++i];
+        } else if(strcmp(argv[i], "--k") == 0 && i + 1 < argc) {
+            k = strtoll(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if(strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppmDir = argv[++i];
+        } else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if(!haveInput) {
+            input = argv[i];
+            haveInput = true;
+        } else {
+            fprintf(stderr, "Unexpected argument \"%s\"\n", argv[i]);
+            return 1;
+        }
+    }
+    int algo = algo_find(algoName);
+    if(algo < 0) {
+        fprintf(stderr, "Unknown algorithm \"%s\"\n", algoName);
+        return 1;
+    }
+    if(speed <= 0) {
+        fprintf(stderr, "Speed must be positive\n");
+        return 1;
+    }
+    if(threads <= 0) {
+        threads = 1;
+    }
+
+    struct export_ctx ctx = { .speed = speed, .fd = -1, .ppmDir = ppmDir };
+    int64_t inputLen;
+    ctx.input = load_numbers(input, &inputLen);
+    if(!ctx.input) {
+        fprintf(stderr, "Nothing to export from %s\n", input);
+        return 1;
+    }
+    if(inputLen > INT_MAX) {
+        fprintf(stderr, "%s: %" PRId64 " numbers are too many to animate\n", input, inputLen);
+        return 1;
+    }
+    ctx.bufLen = inputLen;
+    int64_t *work = malloc_(ctx.bufLen * sizeof(int64_t));
+    memcpy(work, ctx.input, ctx.bufLen * sizeof(int64_t));
+    struct sort_stats stats;
+    int64_t start = get_time_nsec();
+    ctx.swaps = run_sort_record(work, ctx.bufLen, algo, k, &stats);
+    ctx.swapsLen = stats.swaps;
+    free(work);
+
+    // same geometry and timing as run_sort_fds, with the status pane replaced by a progress bar
+    int maxWidth = 0;
+    for(int i = 0; i < ctx.bufLen; i++) {
+        maxWidth = i_max(maxWidth, text_width(ctx.input[i]));
+    }
+    ctx.radius = maxWidth / 2 + 5;
+    ctx.viewportHeight = (ctx.radius * 2 + 10) * 3;
+    ctx.fullWidth = (ctx.radius * 2 + 10) * ctx.bufLen + 10;
+    ctx.verticalDuration = 10 * 20;
+    ctx.horizontalDuration = 20 * 20;
+    // 4:2:0 chroma needs even dimensions
+    ctx.width = (i_max(800, 10 * (ctx.radius * 2 + 10) + 10) + 1) & ~1;
+    ctx.height = (ctx.viewportHeight + STATUS_HEIGHT + 1) & ~1;
+
+    // the camera follows the moving sphere with smoothing, so frame n depends on all frames before it
+    // one cheap pass without drawing saves the loop state at every chunk, then chunks render independently
+    struct export_cursor cursor = {
+        .anim = { .progress = 1, .end = 0, .state = DOWN_2, .sphereIdx1 = -1, .sphereIdx2 = -1 },
+        .focusX = sphere_x(ctx.radius, 0),
+    };
+    int64_t checkpointsCap = 0;
+    for(bool running = true; running; ctx.frames++) {
+        if(ctx.frames % EXPORT_CHUNK == 0) {
+            if(ctx.checkpointsLen == checkpointsCap) {
+                checkpointsCap = checkpointsCap ? checkpointsCap * 2 : 64;
+                struct export_cursor *checkpoints = reallocarray(ctx.checkpoints, checkpointsCap, sizeof(struct export_cursor));
+                if(!checkpoints) {
+                    perror("reallocarray");
+                    exit(1);
+                }
+                ctx.checkpoints = checkpoints;
+            }
+            ctx.checkpoints[ctx.checkpointsLen++] = cursor;
+        }
+        running = export_step(&ctx, &cursor);
+    }
+
+    if(ppmDir) {
+        if(mkdir(ppmDir, 0777) != 0 && errno != EEXIST) {
+            perror("mkdir");
+            return 1;
+        }
+    } else {
+        ctx.fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if(ctx.fd < 0) {
+            perror("open");
+            return 1;
+        }
+        char header[128];
+        ctx.headerLen = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", ctx.width, ctx.height, EXPORT_FPS);
+        pwrite_all(ctx.fd, (uint8_t*)header, ctx.headerLen, 0);
+    }
+
+    if(threads > ctx.checkpointsLen) {
+        threads = ctx.checkpointsLen;
+    }
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_t *tids = malloc_(threads * sizeof(pthread_t));
+    for(long t = 0; t < threads; t++) {
+        int err = pthread_create(&tids[t], NULL, render_thread, &ctx);
+        if(err != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(err));
+            exit(1);
+        }
+    }
+    for(long t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    pthread_mutex_destroy(&ctx.lock);
+    if(ctx.fd >= 0 && close(ctx.fd) != 0) {
+        perror("close");
+        return 1;
+    }
+    double seconds = (get_time_nsec() - start) / 1e9;
+    fprintf(stderr, "%s: %" PRId64 " swaps, %" PRId64 " frames (%.1f s of animation) at %dx%d written to %s in %.2f s on %ld threads\n",
+        algoName, ctx.swapsLen, ctx.frames, (double)ctx.frames / EXPORT_FPS, ctx.width, ctx.height, ppmDir ? ppmDir : out, seconds, threads);
+
+    free(tids);
+    free(ctx.checkpoints);
+    free((int64_t *)ctx.swaps);
+    free((int64_t *)ctx.input);
+    return 0;
+}
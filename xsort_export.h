@@ -0,0 +1,2 @@
+// renders a sort run to a Y4M video or PPM frames without a display, see export_main for the options
+int export_main(int argc, char **argv);
@@ -0,0 +1,901 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/random.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "utils.h"
+#include "xsort_native.h"
+#include "xsort_subproc.h"
+#include "xsort_external.h"
+
+// every read and write of the input, the spill files and the output is done in blocks of this size
+#define EXT_IO_BLOCK (4 << 20)
+// smallest per-run read buffer during a merge, limits the fan-in for small memory budgets
+#define EXT_MIN_MERGE_BLOCK (64 << 10)
+#define EXT_MAX_FANIN 512
+// the visualization is redrawn after this many elements are written
+#define EXT_VISUAL_INTERVAL (1 << 20)
+
+struct io_stats {
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+};
+static struct io_stats io_stats;
+
+static size_t read_block(int fd, char *buf, size_t len) {
+    // returns less than len only at EOF
+    size_t total = 0;
+    while(total < len) {
+        ssize_t bytes = read(fd, buf + total, len - total);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("read");
+            exit(1);
+        }
+        if(bytes == 0) {
+            break;
+        }
+        total += bytes;
+    }
+    io_stats.bytes_read += total;
+    return total;
+}
+
+static size_t read_some(int fd, char *buf, size_t len) {
+    // one read, so a pipe is consumed as fast as the producer writes it; 0 only at EOF
+    while(1) {
+        ssize_t bytes = read(fd, buf, len);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("read");
+            exit(1);
+        }
+        io_stats.bytes_read += bytes;
+        return bytes;
+    }
+}
+
+static void pread_block(int fd, char *buf, size_t len, uint64_t offset) {
+    while(len > 0) {
+        ssize_t bytes = pread(fd, buf, len, offset);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("pread");
+            exit(1);
+        }
+        if(bytes == 0) {
+            fprintf(stderr, "pread: unexpected EOF in spill file\n");
+            exit(1);
+        }
+        io_stats.bytes_read += bytes;
+        buf += bytes;
+        len -= bytes;
+        offset += bytes;
+    }
+}
+
+static void write_block(int fd, char *buf, size_t len) {
+    io_stats.bytes_written += len;
+    write_(fd, buf, len);
+}
+
+// text input, one number per line like xsort_buf.txt
+
+struct text_reader {
+    int fd;
+    char *buf;
+    size_t pos, len;
+    bool eof;
+    // refill with whatever the pipe has instead of waiting for a whole block
+    bool partial;
+};
+
+static int reader_peek(struct text_reader *r) {
+    if(r->pos == r->len) {
+        if(r->eof) {
+            return EOF;
+        }
+        r->len = r->partial ? read_some(r->fd, r->buf, EXT_IO_BLOCK) : read_block(r->fd, r->buf, EXT_IO_BLOCK);
+        r->pos = 0;
+        if(r->partial ? r->len == 0 : r->len < EXT_IO_BLOCK) {
+            r->eof = true;
+        }
+        if(r->len == 0) {
+            return EOF;
+        }
+    }
+    return (unsigned char)r->buf[r->pos];
+}
+
+static bool read_number(struct text_reader *r, int64_t *num) {
+    int c;
+    while((c = reader_peek(r)) == ' ' || c == '\n' || c == '\t' || c == '\r') {
+        r->pos++;
+    }
+    if(c == EOF) {
+        return false;
+    }
+    bool negative = false;
+    if(c == '-') {
+        negative = true;
+        r->pos++;
+        c = reader_peek(r);
+    }
+    if(c < '0' || c > '9') {
+        fprintf(stderr, "Invalid character '%c' in input\n", c == EOF ? '?' : c);
+        exit(1);
+    }
+    uint64_t magnitude = 0;
+    while(c >= '0' && c <= '9') {
+        magnitude = magnitude * 10 + (c - '0');
+        r->pos++;
+        c = reader_peek(r);
+    }
+    *num = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+struct text_writer {
+    int fd;
+    char *buf;
+    size_t len;
+};
+
+static void writer_put(struct text_writer *w, int64_t num) {
+    if(w->len + 32 > EXT_IO_BLOCK) {
+        write_block(w->fd, w->buf, w->len);
+        w->len = 0;
+    }
+    w->len += sprintf(w->buf + w->len, "%" PRId64 "\n", num);
+}
+
+static void writer_flush(struct text_writer *w) {
+    write_block(w->fd, w->buf, w->len);
+    w->len = 0;
+}
+
+// spill files hold the binary runs of one pass back to back, runs are addressed by element offset
+
+struct run {
+    uint64_t offset;
+    uint64_t len;
+};
+
+struct spill_file {
+    int fd;
+    uint64_t size;
+    struct run *runs;
+    int runsLen;
+    int runsCap;
+};
+
+static void spill_open(struct spill_file *spill) {
+    const char *dir = getenv("TMPDIR");
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/xsort_spill_XXXXXX", dir ? dir : "/tmp");
+    spill->fd = mkstemp(path);
+    if(spill->fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    // unlinked right away, so the space is released even if the sort is interrupted
+    unlink(path);
+    spill->size = 0;
+    spill->runs = NULL;
+    spill->runsLen = 0;
+    spill->runsCap = 0;
+}
+
+static void spill_close(struct spill_file *spill) {
+    close_(spill->fd);
+    free(spill->runs);
+}
+
+static void spill_add_run(struct spill_file *spill, uint64_t len) {
+    if(spill->runsLen == spill->runsCap) {
+        spill->runsCap = spill->runsCap == 0 ? 16 : spill->runsCap * 2;
+        spill->runs = reallocarray(spill->runs, spill->runsCap, sizeof(struct run));
+        if(!spill->runs) {
+            perror("reallocarray");
+            exit(1);
+        }
+    }
+    spill->runs[spill->runsLen++] = (struct run){ .offset = spill->size, .len = len };
+    spill->size += len;
+}
+
+struct run_reader {
+    int fd;
+    uint64_t next;
+    uint64_t remaining;
+    int64_t *buf;
+    size_t pos, len, cap;
+};
+
+static bool run_reader_exhausted(struct run_reader *r) {
+    return r->pos == r->len && r->remaining == 0;
+}
+
+static void run_reader_fill(struct run_reader *r) {
+    size_t count = r->remaining < r->cap ? r->remaining : r->cap;
+    pread_block(r->fd, (char*)r->buf, count * sizeof(int64_t), r->next * sizeof(int64_t));
+    r->next += count;
+    r->remaining -= count;
+    r->pos = 0;
+    r->len = count;
+}
+
+static void run_reader_advance(struct run_reader *r) {
+    r->pos++;
+    if(r->pos == r->len && r->remaining > 0) {
+        run_reader_fill(r);
+    }
+}
+
+// loser tree over k run readers: internal node i stores the loser of the match played there, tree[0] the overall winner
+
+struct loser_tree {
+    int k;
+    int *tree;
+    struct run_reader *readers;
+};
+
+static bool beats(struct loser_tree *lt, int a, int b) {
+    if(run_reader_exhausted(&lt->readers[b])) {
+        return true;
+    }
+    if(run_reader_exhausted(&lt->readers[a])) {
+        return false;
+    }
+    int64_t x = lt->readers[a].buf[lt->readers[a].pos];
+    int64_t y = lt->readers[b].buf[lt->readers[b].pos];
+    return x < y || (x == y && a < b);
+}
+
+static void loser_tree_init(struct loser_tree *lt, struct run_reader *readers, int k) {
+    lt->k = k;
+    lt->readers = readers;
+    lt->tree = malloc_(k * sizeof(int));
+    // leaves are the implicit nodes k..2k-1, play all matches bottom up
+    int *winners = malloc_(2 * k * sizeof(int));
+    for(int i = 0; i < k; i++) {
+        winners[k + i] = i;
+    }
+    for(int node = k - 1; node >= 1; node--) {
+        int a = winners[2 * node];
+        int b = winners[2 * node + 1];
+        if(beats(lt, a, b)) {
+            winners[node] = a;
+            lt->tree[node] = b;
+        } else {
+            winners[node] = b;
+            lt->tree[node] = a;
+        }
+    }
+    lt->tree[0] = k == 1 ? 0 : winners[1];
+    free(winners);
+}
+
+static void loser_tree_replay(struct loser_tree *lt, int leaf) {
+    // only the matches on the path from the leaf to the root can change
+    int winner = leaf;
+    for(int node = (leaf + lt->k) / 2; node >= 1; node /= 2) {
+        if(beats(lt, lt->tree[node], winner)) {
+            int tmp = lt->tree[node];
+            lt->tree[node] = winner;
+            winner = tmp;
+        }
+    }
+    lt->tree[0] = winner;
+}
+
+// optional coarse visualization: one row for run generation, one row per merge pass
+
+struct ext_visual {
+    Display *display;
+    Window window;
+    GC gc;
+    GC erase_gc;
+    XFontStruct *font;
+    Atom WM_DELETE_WINDOW;
+    int width, height;
+    int rowHeight;
+};
+
+static bool visual_open(struct ext_visual *v) {
+    v->display = XOpenDisplay(NULL);
+    if(!v->display) {
+        fprintf(stderr, "Failed to open display, continuing without visualization\n");
+        return false;
+    }
+    int blackColor = BlackPixel(v->display, DefaultScreen(v->display));
+    int whiteColor = WhitePixel(v->display, DefaultScreen(v->display));
+    const char *fontQuery = "fixed";
+    v->font = XLoadQueryFont(v->display, fontQuery);
+    if(!v->font) {
+        fprintf(stderr, "Failed to load font \"%s\"\n", fontQuery);
+        XCloseDisplay(v->display);
+        return false;
+    }
+    v->rowHeight = (v->font->ascent + v->font->descent) * 2 + 20;
+    v->width = 800;
+    v->height = v->rowHeight * 6;
+    v->window = XCreateSimpleWindow(v->display, DefaultRootWindow(v->display), 0, 0, v->width, v->height, 0, blackColor, whiteColor);
+    XClassHint *classHint = XAllocClassHint();
+    if(classHint) {
+        classHint->res_name = get_instance_name();
+        classHint->res_class = "XSort (external)";
+        XSetClassHint(v->display, v->window, classHint);
+        XFree(classHint);
+    } else {
+        fprintf(stderr, "XAllocClassHint failed\n");
+    }
+    XStoreName(v->display, v->window, "XSort - external sort");
+    v->gc = XCreateGC(v->display, v->window, 0, NULL);
+    v->erase_gc = XCreateGC(v->display, v->window, 0, NULL);
+    XSetForeground(v->display, v->gc, blackColor);
+    XSetFont(v->display, v->gc, v->font->fid);
+    XSetForeground(v->display, v->erase_gc, whiteColor);
+    v->WM_DELETE_WINDOW = XInternAtom(v->display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(v->display, v->window, &v->WM_DELETE_WINDOW, 1);
+    XSelectInput(v->display, v->window, ExposureMask | StructureNotifyMask);
+    XMapWindow(v->display, v->window);
+    XFlush(v->display);
+    return true;
+}
+
+static void visual_close(struct ext_visual *v) {
+    if(!v->display) {
+        return;
+    }
+    XFreeGC(v->display, v->gc);
+    XFreeGC(v->display, v->erase_gc);
+    XFreeFont(v->display, v->font);
+    XDestroyWindow(v->display, v->window);
+    XCloseDisplay(v->display);
+    v->display = NULL;
+}
+
+static void visual_poll(struct ext_visual *v) {
+    // the sort never waits on the window, closing it only stops the visualization
+    while(v->display && XPending(v->display) > 0) {
+        XEvent e;
+        XNextEvent(v->display, &e);
+        if(e.type == ClientMessage && (Atom)e.xclient.data.l[0] == v->WM_DELETE_WINDOW) {
+            visual_close(v);
+            return;
+        }
+        if(e.type == ConfigureNotify) {
+            v->width = e.xconfigure.width;
+            v->height = e.xconfigure.height;
+        }
+    }
+}
+
+static void visual_draw_row(struct ext_visual *v, int row, const char *label, const struct run *runs, const uint64_t *consumed, int runsLen, uint64_t total) {
+    // each run is a box proportional to its length, filled up to the part already consumed
+    if(!v->display) {
+        return;
+    }
+    int y = row * v->rowHeight + 5;
+    int barY = y + v->font->ascent + v->font->descent + 5;
+    int barHeight = v->rowHeight - (barY - y) - 10;
+    int barWidth = v->width - 20;
+    XFillRectangle(v->display, v->window, v->erase_gc, 0, y, v->width, v->rowHeight);
+    XDrawString(v->display, v->window, v->gc, 10, y + v->font->ascent, label, strlen(label));
+    if(total == 0) {
+        XFlush(v->display);
+        return;
+    }
+    for(int i = 0; i < runsLen; i++) {
+        int x0 = 10 + (int)((double)runs[i].offset / total * barWidth);
+        int x1 = 10 + (int)((double)(runs[i].offset + runs[i].len) / total * barWidth);
+        XDrawRectangle(v->display, v->window, v->gc, x0, barY, i_max(1, x1 - x0), barHeight);
+        if(consumed) {
+            int filled = (int)((double)consumed[i] / total * barWidth);
+            XFillRectangle(v->display, v->window, v->gc, x0, barY, filled, barHeight);
+        }
+    }
+    XFlush(v->display);
+}
+
+// run generation and merging
+
+struct ext_options {
+    const char *input;
+    const char *output;
+    size_t memory;
+    bool visual;
+};
+
+static void write_run(struct spill_file *spill, int64_t *buf, uint64_t len) {
+    char *bytes = (char*)buf;
+    uint64_t left = len * sizeof(int64_t);
+    while(left > 0) {
+        size_t chunk = left < EXT_IO_BLOCK ? left : EXT_IO_BLOCK;
+        write_block(spill->fd, bytes, chunk);
+        bytes += chunk;
+        left -= chunk;
+    }
+    spill_add_run(spill, len);
+}
+
+struct merge_progress {
+    struct ext_visual *v;
+    int row;
+    const struct spill_file *in;
+    // elements taken from each run of in
+    uint64_t *consumed;
+    int first;
+};
+
+static uint64_t merge_readers(struct run_reader *readers, int count, struct spill_file *out, struct text_writer *text, struct merge_progress *progress) {
+    // k-way merge into a new run of out, or into the text output, returns the number of elements
+    struct loser_tree lt;
+    loser_tree_init(&lt, readers, count);
+    int64_t *outBuf = out ? malloc_(EXT_IO_BLOCK) : NULL;
+    size_t outLen = 0;
+    const size_t outCap = EXT_IO_BLOCK / sizeof(int64_t);
+    uint64_t written = 0;
+    while(!run_reader_exhausted(&readers[lt.tree[0]])) {
+        int winner = lt.tree[0];
+        int64_t num = readers[winner].buf[readers[winner].pos];
+        if(out) {
+            outBuf[outLen++] = num;
+            if(outLen == outCap) {
+                write_block(out->fd, (char*)outBuf, outLen * sizeof(int64_t));
+                outLen = 0;
+            }
+        } else {
+            writer_put(text, num);
+        }
+        run_reader_advance(&readers[winner]);
+        loser_tree_replay(&lt, winner);
+        written++;
+        if(progress) {
+            progress->consumed[progress->first + winner]++;
+            if(written % EXT_VISUAL_INTERVAL == 0 && progress->v->display) {
+                char label[128];
+                snprintf(label, sizeof(label), "merge pass %d: %d runs", progress->row, progress->in->runsLen);
+                visual_draw_row(progress->v, progress->row, label, progress->in->runs, progress->consumed, progress->in->runsLen, progress->in->size);
+                visual_poll(progress->v);
+            }
+        }
+    }
+    if(out) {
+        write_block(out->fd, (char*)outBuf, outLen * sizeof(int64_t));
+        spill_add_run(out, written);
+        free(outBuf);
+    }
+    free(lt.tree);
+    return written;
+}
+
+static void merge_runs(struct spill_file *in, int first, int count, size_t blockElems, struct spill_file *out, struct text_writer *text, struct ext_visual *v, int row, uint64_t *consumed) {
+    // k-way merge of runs [first, first + count) into a new run of out, or into the text output
+    struct run_reader *readers = malloc_(count * sizeof(struct run_reader));
+    for(int i = 0; i < count; i++) {
+        struct run *run = &in->runs[first + i];
+        readers[i] = (struct run_reader){ .fd = in->fd, .next = run->offset, .remaining = run->len, .buf = malloc_(blockElems * sizeof(int64_t)), .cap = blockElems };
+        if(run->len > 0) {
+            run_reader_fill(&readers[i]);
+        }
+    }
+    struct merge_progress progress = { v, row, in, consumed, first };
+    merge_readers(readers, count, out, text, &progress);
+    for(int i = 0; i < count; i++) {
+        free(readers[i].buf);
+    }
+    free(readers);
+}
+
+static int merge_passes(struct spill_file *spill, size_t memory, struct text_writer *writer, struct ext_visual *v, bool verbose) {
+    // merges the runs of spill until they fit in one final merge into writer, returns the number of passes
+    // verbose reports every pass on stderr
+    // memory covers writer's block and the output block of a pass, the run buffers share the rest
+    size_t mergeMemory = memory - 2 * EXT_IO_BLOCK;
+    int fanin = mergeMemory / EXT_MIN_MERGE_BLOCK;
+    if(fanin > EXT_MAX_FANIN) fanin = EXT_MAX_FANIN;
+    if(fanin < 2) fanin = 2;
+    int passes = 0;
+    while(spill->runsLen > 0) {
+        int count = spill->runsLen;
+        int k = count < fanin ? count : fanin;
+        size_t blockElems = mergeMemory / k / sizeof(int64_t);
+        if(blockElems > EXT_IO_BLOCK / sizeof(int64_t)) {
+            blockElems = EXT_IO_BLOCK / sizeof(int64_t);
+        }
+        if(blockElems == 0) {
+            blockElems = 1;
+        }
+        uint64_t *consumed = calloc(count ? count : 1, sizeof(uint64_t));
+        if(!consumed) {
+            perror("calloc");
+            exit(1);
+        }
+        passes++;
+        if(verbose) {
+            fprintf(stderr, "merge pass %d: %d runs, fan-in %d\n", passes, count, k);
+        }
+        if(count <= fanin) {
+            merge_runs(spill, 0, count, blockElems, NULL, writer, v, passes, consumed);
+            free(consumed);
+            break;
+        }
+        struct spill_file next;
+        spill_open(&next);
+        for(int first = 0; first < count; first += fanin) {
+            merge_runs(spill, first, i_min(fanin, count - first), blockElems, &next, NULL, v, passes, consumed);
+        }
+        free(consumed);
+        spill_close(spill);
+        *spill = next;
+    }
+    return passes;
+}
+
+static int external_sort(struct ext_options *opts) {
+    struct ext_visual v = { .display = NULL };
+    if(opts->visual) {
+        visual_open(&v);
+    }
+    int64_t start = get_time_nsec();
+
+    int in_fd = open(opts->input, O_RDONLY);
+    if(in_fd < 0) {
+        perror(opts->input);
+        return 1;
+    }
+    struct stat st;
+    uint64_t inputSize = fstat(in_fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    int out_fd = open(opts->output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(out_fd < 0) {
+        perror(opts->output);
+        return 1;
+    }
+    struct text_reader reader = { .fd = in_fd, .buf = malloc_(EXT_IO_BLOCK) };
+    struct text_writer writer = { .fd = out_fd, .buf = malloc_(EXT_IO_BLOCK) };
+
+    // phase 1: fill the memory budget, sort it, spill it as a run
+    size_t runCap = (opts->memory - 2 * EXT_IO_BLOCK) / sizeof(int64_t);
+    int64_t *runBuf = malloc_(runCap * sizeof(int64_t));
+    struct spill_file spill;
+    spill_open(&spill);
+    uint64_t total = 0;
+    bool singleRun = false;
+    while(1) {
+        size_t len = 0;
+        int64_t num;
+        while(len < runCap && read_number(&reader, &num)) {
+            runBuf[len++] = num;
+        }
+        if(len == 0) {
+            break;
+        }
+        native_avx2_sort(runBuf, len);
+        total += len;
+        if(spill.runsLen == 0 && len < runCap) {
+            // everything fit in memory, no need to spill
+            for(size_t i = 0; i < len; i++) {
+                writer_put(&writer, runBuf[i]);
+            }
+            singleRun = true;
+            break;
+        }
+        write_run(&spill, runBuf, len);
+        if(v.display) {
+            char label[128];
+            snprintf(label, sizeof(label), "run generation: %d runs, %" PRIu64 " numbers", spill.runsLen, total);
+            struct run progress = { .offset = 0, .len = inputSize ? inputSize : 1 };
+            uint64_t readSoFar = io_stats.bytes_read;
+            visual_draw_row(&v, 0, label, &progress, &readSoFar, 1, progress.len);
+            visual_poll(&v);
+        }
+        if(len < runCap) {
+            break;
+        }
+    }
+    free(runBuf);
+    free(reader.buf);
+    close_(in_fd);
+    int64_t runTime = get_time_nsec() - start;
+    int runs = singleRun ? 1 : spill.runsLen;
+
+    // phase 2: merge passes until the runs fit in one final merge
+    int passes = singleRun ? 0 : merge_passes(&spill, opts->memory, &writer, &v, true);
+    writer_flush(&writer);
+    spill_close(&spill);
+    if(close(out_fd) != 0) {
+        perror("close");
+        return 1;
+    }
+    free(writer.buf);
+
+    double seconds = (get_time_nsec() - start) / 1e9;
+    fprintf(stderr, "sorted %" PRIu64 " numbers from %s into %s\n", total, opts->input, opts->output);
+    fprintf(stderr, "%d initial run%s (%.3f s), %d merge pass%s, %.3f s total\n", runs, runs == 1 ? "" : "s", runTime / 1e9, passes, passes == 1 ? "" : "es", seconds);
+    fprintf(stderr, "read %.1f MiB, wrote %.1f MiB, %.1f MiB/s combined\n", io_stats.bytes_read / 1048576.0, io_stats.bytes_written / 1048576.0, (io_stats.bytes_read + io_stats.bytes_written) / 1048576.0 / seconds);
+    if(v.display) {
+        // leave the final picture up until the window is closed
+        XEvent e;
+        while(v.display) {
+            XPeekEvent(v.display, &e);
+            visual_poll(&v);
+        }
+    }
+    return 0;
+}
+
+static int generate_input(const char *path, uint64_t count) {
+    // random numbers in the same text format, for producing datasets larger than memory
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        perror(path);
+        return 1;
+    }
+    struct text_writer writer = { .fd = fd, .buf = malloc_(EXT_IO_BLOCK) };
+    int64_t nums[512];
+    for(uint64_t i = 0; i < count; i++) {
+        if(i % 512 == 0) {
+            while(getrandom(nums, sizeof(nums), 0) < 0) {
+                if(errno == EINTR) continue;
+                perror("getrandom");
+                exit(1);
+            }
+        }
+        writer_put(&writer, nums[i % 512]);
+    }
+    writer_flush(&writer);
+    free(writer.buf);
+    if(close(fd) != 0) {
+        perror("close");
+        return 1;
+    }
+    return 0;
+}
+
+int external_main(int argc, char **argv) {
+    // usage: xsort --external [--mem MIB] [--visual] [--generate COUNT] [INPUT [OUTPUT]]
+    // MIB bounds the sort and merge buffers together with the I/O blocks
+    struct ext_options opts = {
+        .input = "xsort_buf.txt",
+        .output = "xsort_buf_sorted.txt",
+        .memory = (size_t)256 << 20,
+        .visual = false,
+    };
+    uint64_t generate = 0;
+    int positional = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--mem") == 0 && i + 1 < argc) {
+            opts.memory = (size_t)strtoull(argv[++i], NULL, 10) << 20;
+        } else if(strcmp(argv[i], "--visual") == 0) {
+            opts.visual = true;
+        } else if(strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generate = strtoull(argv[++i], NULL, 10);
+        } else if(positional == 0) {
+            opts.input = argv[i];
+            positional++;
+        } else if(positional == 1) {
+            opts.output = argv[i];
+            positional++;
+        } else {
+            fprintf(stderr, "Unexpected argument \"%s\"\n", argv[i]);
+            return 1;
+        }
+    }
+    if(generate > 0) {
+        return generate_input(opts.input, generate);
+    }
+    if(opts.memory < 4 * (size_t)EXT_IO_BLOCK) {
+        fprintf(stderr, "Memory budget must be at least %d MiB\n", 4 * EXT_IO_BLOCK >> 20);
+        return 1;
+    }
+    return external_sort(&opts);
+}
+
+// streaming mode: numbers from stdin to stdout, for use in pipelines
+// sorted runs are built and merged while the input is still arriving, so at EOF only the last
+// chunk and a merge of a few runs are left before the output starts
+
+// the unsorted tail is sorted into a new run whenever it reaches this many elements
+#define STREAM_CHUNK (1 << 16)
+// runs are merged like a binary counter, so there are at most log2(memory / STREAM_CHUNK) + 1
+#define STREAM_MAX_RUNS 64
+
+// short names for the native sorts, the full names and the instrumented algorithms work too
+static const struct {
+    const char *alias;
+    const char *name;
+} stream_aliases[] = {
+    { "qsort", "libc qsort" },
+    { "quick", "pdqsort" },
+    { "block", "BlockQuicksort" },
+    { "avx2", "AVX2 Sort" },
+    { "bitonic", "Bitonic Network" },
+    { "odd-even", "Odd-Even Network" },
+};
+#define STREAM_ALIASES_LEN ((int)(sizeof(stream_aliases) / sizeof(stream_aliases[0])))
+
+struct stream_sorter {
+    native_sort native;
+    // one of the instrumented algorithms when native is NULL, much slower because of the pipe
+    int algoSelection;
+};
+
+static bool stream_find_sorter(const char *name, struct stream_sorter *sorter) {
+    for(int a = 0; a < STREAM_ALIASES_LEN; a++) {
+        if(strcmp(stream_aliases[a].alias, name) == 0) {
+            name = stream_aliases[a].name;
+        }
+    }
+    for(int algo = 0; algo < NATIVE_LEN; algo++) {
+        if(strcmp(native_names[algo], name) == 0) {
+            *sorter = (struct stream_sorter){ native_algos[algo], -1 };
+            return true;
+        }
+    }
+    int algo = algo_find(name);
+    if(algo >= 0 && algo_goal(algo, 1, 0).kind == GOAL_FULL) {
+        *sorter = (struct stream_sorter){ NULL, algo };
+        return true;
+    }
+    return false;
+}
+
+struct stream_state {
+    // the runs back to back, then the unsorted tail
+    int64_t *buf;
+    int64_t cap, len;
+    // the left run of a merge is never longer than the right one, so half of cap is enough
+    int64_t *scratch;
+    struct run runs[STREAM_MAX_RUNS];
+    int runsLen;
+};
+
+static int64_t stream_sorted_len(const struct stream_state *st) {
+    return st->runsLen ? (int64_t)(st->runs[st->runsLen - 1].offset + st->runs[st->runsLen - 1].len) : 0;
+}
+
+static void stream_merge_last(struct stream_state *st) {
+    // merges the last two runs in place, with the left one moved to scratch
+    struct run *left = &st->runs[st->runsLen - 2], *right = &st->runs[st->runsLen - 1];
+    int64_t *a = st->scratch, *b = st->buf + right->offset;
+    int64_t *aEnd = a + left->len, *bEnd = b + right->len;
+    memcpy(a, st->buf + left->offset, left->len * sizeof(int64_t));
+    int64_t *out = st->buf + left->offset;
+    while(a < aEnd && b < bEnd) {
+        *out++ = *b < *a ? *b++ : *a++;
+    }
+    memcpy(out, a, (aEnd - a) * sizeof(int64_t));
+    left->len += right->len;
+    st->runsLen--;
+}
+
+static void stream_sort_tail(struct stream_state *st, const struct stream_sorter *sorter) {
+    int64_t start = stream_sorted_len(st);
+    int64_t len = st->len - start;
+    if(len == 0) {
+        return;
+    }
+    if(sorter->native) {
+        sorter->native(st->buf + start, len);
+    } else {
+        struct sort_stats stats;
+        run_sort_headless(st->buf + start, len, sorter->algoSelection, 0, &stats);
+    }
+    assert(st->runsLen < STREAM_MAX_RUNS);
+    st->runs[st->runsLen++] = (struct run){ .offset = start, .len = len };
+    while(st->runsLen >= 2 && st->runs[st->runsLen - 2].len <= st->runs[st->runsLen - 1].len) {
+        stream_merge_last(st);
+    }
+}
+
+static void stream_merge_memory(struct stream_state *st, struct spill_file *out, struct text_writer *text) {
+    // the in-memory runs are read in place, so the readers never refill
+    struct run_reader *readers = malloc_((st->runsLen ? st->runsLen : 1) * sizeof(struct run_reader));
+    for(int i = 0; i < st->runsLen; i++) {
+        readers[i] = (struct run_reader){ .buf = st->buf + st->runs[i].offset, .len = st->runs[i].len, .cap = st->runs[i].len };
+    }
+    if(st->runsLen > 0) {
+        merge_readers(readers, st->runsLen, out, text, NULL);
+    }
+    free(readers);
+    st->runsLen = 0;
+    st->len = 0;
+}
+
+int stream_main(int argc, char **argv) {
+    // usage: xsort --stream [--algo NAME] [--mem MIB] [--verbose]
+    // NAME is qsort, quick, block, avx2 (the default), bitonic, odd-even or the name of any full sort in the window
+    // input larger than MIB (256 by default) is spilled to $TMPDIR as sorted runs, like --external
+    const char *algoName = "avx2";
+    size_t memory = (size_t)256 << 20;
+    bool verbose = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--algo") == 0 && i + 1 < argc) {
+            algoName = argv[++i];
+        } else if(strcmp(argv[i], "--mem") == 0 && i + 1 < argc) {
+            memory = (size_t)strtoull(argv[++i], NULL, 10) << 20;
+        } else if(strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Unexpected argument \"%s\"\n", argv[i]);
+            return 1;
+        }
+    }
+    struct stream_sorter sorter;
+    if(!stream_find_sorter(algoName, &sorter)) {
+        fprintf(stderr, "Unknown algorithm \"%s\"\n", algoName);
+        return 1;
+    }
+    if(memory < 4 * (size_t)EXT_IO_BLOCK) {
+        fprintf(stderr, "Memory budget must be at least %d MiB\n", 4 * EXT_IO_BLOCK >> 20);
+        return 1;
+    }
+    int64_t start = get_time_nsec();
+
+    // the reader and writer blocks come out of the budget, the rest is split 2:1 between runs and scratch
+    // the reader, the writer and the output block of a spill are the 3 blocks outside the run buffer
+    struct stream_state st = { .cap = (memory - 3 * EXT_IO_BLOCK) / sizeof(int64_t) / 3 * 2 };
+    st.buf = malloc_(st.cap * sizeof(int64_t));
+    st.scratch = malloc_(st.cap / 2 * sizeof(int64_t));
+    struct text_reader reader = { .fd = STDIN_FILENO, .buf = malloc_(EXT_IO_BLOCK), .partial = true };
+    struct text_writer writer = { .fd = STDOUT_FILENO, .buf = malloc_(EXT_IO_BLOCK) };
+    struct spill_file spill;
+    spill_open(&spill);
+    uint64_t total = 0;
+    int64_t num;
+    while(read_number(&reader, &num)) {
+        if(st.len == st.cap) {
+            // memory is full, everything sorted so far becomes one run on disk
+            stream_sort_tail(&st, &sorter);
+            stream_merge_memory(&st, &spill, NULL);
+        }
+        st.buf[st.len++] = num;
+        total++;
+        if(st.len - stream_sorted_len(&st) == STREAM_CHUNK) {
+            stream_sort_tail(&st, &sorter);
+        }
+    }
+    int64_t eof = get_time_nsec();
+    stream_sort_tail(&st, &sorter);
+    int runs = st.runsLen;
+    int spilled = spill.runsLen;
+    int passes = 0;
+    if(spill.runsLen == 0) {
+        stream_merge_memory(&st, NULL, &writer);
+    } else {
+        stream_merge_memory(&st, &spill, NULL);
+    }
+    // everything left is on disk or written, the merge gets the whole budget
+    free(st.buf);
+    free(st.scratch);
+    free(reader.buf);
+    if(spill.runsLen > 0) {
+        struct ext_visual v = { .display = NULL };
+        passes = merge_passes(&spill, memory, &writer, &v, verbose);
+    }
+    writer_flush(&writer);
+    spill_close(&spill);
+    free(writer.buf);
+    if(verbose) {
+        int64_t end = get_time_nsec();
+        fprintf(stderr, "sorted %" PRIu64 " numbers with %s in %.3f s, %.3f s of it after EOF\n", total, algoName, (end - start) / 1e9, (end - eof) / 1e9);
+        fprintf(stderr, "%d run%s in memory at EOF, %d spilled, %d merge pass%s\n", runs, runs == 1 ? "" : "s", spilled, passes, passes == 1 ? "" : "es");
+    }
+    return 0;
+}
@@ -0,0 +1,2 @@
+int external_main(int argc, char **argv);
+int stream_main(int argc, char **argv);
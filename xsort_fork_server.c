@@ -0,0 +1,438 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "utils.h"
+#include "xsort_subproc.h"
+#include "xsort_usage.h"
+#include "xsort_fork_server.h"
+
+const char * const priority_names[PRIORITIES_LEN] = {
+    [PRIORITY_LOW] = "low",
+    [PRIORITY_NORMAL] = "normal",
+    [PRIORITY_HIGH] = "high",
+};
+
+void write_request(int fd, const struct sort_request *req) {
+    write_int(fd, req->algoSelection);
+    if(req->algoSelection < 0) {
+        return;
+    }
+    write_int64(fd, req->k);
+    write_int(fd, req->elemType);
+    write_int(fd, req->priority);
+    write_int64(fd, req->launchUsec);
+    write_varint(fd, req->bufLen);
+    write_(fd, (char*)req->buf, req->bufLen * sizeof(int64_t));
+}
+
+// req->buf is reused between requests, only algoSelection is set for the REQUEST_ values
+static void read_request(int fd, struct sort_request *req) {
+    req->algoSelection = read_int(fd);
+    if(req->algoSelection < 0) {
+        return;
+    }
+    req->k = read_int64(fd);
+    req->elemType = read_int(fd);
+    req->priority = read_int(fd);
+    req->launchUsec = read_int64(fd);
+    req->bufLen = read_varint(fd);
+    int64_t *buf = reallocarray(req->buf, req->bufLen ? req->bufLen : 1, sizeof(int64_t));
+    if(!buf) {
+        perror("reallocarray");
+        exit(1);
+    }
+    req->buf = buf;
+    read_(fd, (char*)req->buf, req->bufLen * sizeof(int64_t));
+}
+
+// renderers forked ahead of time that have connected to X and loaded their font,
+// so a LAUNCH only has to create the window and fork the algorithm
+#define RENDERER_POOL_LEN 3
+
+struct pooled_renderer {
+    pid_t pid;
+    // write end, the renderer reads one sort_request from it
+    int request_fd;
+    // read end, one byte once renderer_open is done, hangs up when the renderer dies
+    int ready_fd;
+    bool ready;
+};
+
+static void pool_fill(struct pooled_renderer *pool, int slot, int status_fd) {
+    int request_fds[2], ready_fds[2];
+    pipe_(request_fds);
+    pipe_(ready_fds);
+    pid_t pid = fork();
+    if(pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if(pid != 0) {
+        // its own process group, so cancelling a job also stops the algorithm child
+        setpgid(pid, pid);
+        close_(request_fds[0]);
+        close_(ready_fds[1]);
+        pool[slot] = (struct pooled_renderer){ .pid = pid, .request_fd = request_fds[1], .ready_fd = ready_fds[0] };
+        return;
+    }
+    setpgid(0, 0);
+    signal(SIGCHLD, SIG_DFL);
+    close_(request_fds[1]);
+    close_(ready_fds[0]);
+    for(int i = 0; i < RENDERER_POOL_LEN; i++) {
+        if(i != slot && pool[i].pid) {
+            close_(pool[i].request_fd);
+            close_(pool[i].ready_fd);
+        }
+    }
+    struct renderer *r = renderer_open(true);
+    char ready = 1;
+    // the write end stays open until exit, for the liveness check in pool_take
+    write_(ready_fds[1], &ready, 1);
+    struct sort_request req = {0};
+    read_request(request_fds[0], &req);
+    if(req.algoSelection >= 0) {
+        run_sort(r, req.buf, req.bufLen, req.algoSelection, req.k, req.elemType, req.launchUsec, status_fd);
+    }
+    renderer_close(r);
+    free(req.buf);
+    exit(0);
+}
+
+static void pool_drop(struct pooled_renderer *p) {
+    close_(p->request_fd);
+    close_(p->ready_fd);
+    p->pid = 0;
+}
+
+// a ready renderer, or NULL if all of them are still warming up
+static struct pooled_renderer *pool_take(struct pooled_renderer *pool, int status_fd) {
+    for(int i = 0; i < RENDERER_POOL_LEN; i++) {
+        struct pooled_renderer *p = &pool[i];
+        if(!p->pid) {
+            pool_fill(pool, i, status_fd);
+            continue;
+        }
+        struct pollfd pfd = { .fd = p->ready_fd, .events = POLLIN };
+        bool event = poll(&pfd, 1, 0) > 0;
+        if(p->ready) {
+            if(event && (pfd.revents & POLLHUP)) {
+                // lost its X connection while waiting
+                pool_drop(p);
+                continue;
+            }
+        } else {
+            if(!event) {
+                // still warming up
+                continue;
+            }
+            char ready;
+            if(read(p->ready_fd, &ready, 1) != 1) {
+                // it could not open the display, try again with a fresh one next time
+                pool_drop(p);
+                continue;
+            }
+            p->ready = true;
+        }
+        return p;
+    }
+    return NULL;
+}
+
+// returns the pid of the renderer, which leads its own process group
+static pid_t spawn_sort(struct pooled_renderer *pool, const struct sort_request *req, int status_fd) {
+    struct pooled_renderer *p = pool_take(pool, status_fd);
+    if(p) {
+        pid_t pid = p->pid;
+        write_request(p->request_fd, req);
+        pool_drop(p);
+        pool_fill(pool, p - pool, status_fd);
+        return pid;
+    }
+    // cold start, e.g. for the burst of an "All" launch
+    pid_t sort_pid = fork();
+    if(sort_pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if(sort_pid == 0) {
+        setpgid(0, 0);
+        signal(SIGCHLD, SIG_DFL);
+        struct renderer *r = renderer_open(false);
+        run_sort(r, req->buf, req->bufLen, req->algoSelection, req->k, req->elemType, req->launchUsec, status_fd);
+        renderer_close(r);
+        exit(0);
+    }
+    setpgid(sort_pid, sort_pid);
+    return sort_pid;
+}
+
+struct job {
+    int id;
+    enum { JOB_QUEUED, JOB_RUNNING } state;
+    // of the renderer, once running
+    pid_t pid;
+    bool cancelled;
+    time_t startUsec;
+    // owns req.buf
+    struct sort_request req;
+};
+
+struct job_table {
+    struct job *jobs;
+    int len, cap;
+    int nextId;
+    int running;
+    int maxRunning;
+    // queue length of the last progress line
+    int reportedQueued;
+};
+
+static void job_describe(const struct job *job, char *str, size_t len) {
+    snprintf(str, len, "Job %d (%s, %s priority)", job->id, algo_name(job->req.algoSelection), priority_names[job->req.priority]);
+}
+
+static void job_add(struct job_table *table, const struct sort_request *req) {
+    if(table->len == table->cap) {
+        int cap = table->cap ? table->cap * 2 : 16;
+        struct job *jobs = reallocarray(table->jobs, cap, sizeof(struct job));
+        if(!jobs) {
+            perror("reallocarray");
+            exit(1);
+        }
+        table->jobs = jobs;
+        table->cap = cap;
+    }
+    struct job *job = &table->jobs[table->len++];
+    *job = (struct job){ .id = table->nextId++, .state = JOB_QUEUED, .req = *req };
+    job->req.buf = malloc((req->bufLen ? req->bufLen : 1) * sizeof(int64_t));
+    if(!job->req.buf) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(job->req.buf, req->buf, req->bufLen * sizeof(int64_t));
+}
+
+static void job_remove(struct job_table *table, struct job *job) {
+    free(job->req.buf);
+    // the queue order comes from priority and id, not from the position in the table
+    *job = table->jobs[--table->len];
+}
+
+// highest priority first, then the oldest
+static struct job *job_next(struct job_table *table) {
+    struct job *next = NULL;
+    for(int i = 0; i < table->len; i++) {
+        struct job *job = &table->jobs[i];
+        if(job->state != JOB_QUEUED) {
+            continue;
+        }
+        if(!next || job->req.priority > next->req.priority || (job->req.priority == next->req.priority && job->id < next->id)) {
+            next = job;
+        }
+    }
+    return next;
+}
+
+static void schedule(struct job_table *table, struct pooled_renderer *pool, int status_fd) {
+    struct job *job;
+    while(table->running < table->maxRunning && (job = job_next(table)) != NULL) {
+        job->pid = spawn_sort(pool, &job->req, status_fd);
+        job->state = JOB_RUNNING;
+        job->startUsec = get_time_usec();
+        table->running++;
+    }
+    int queued = table->len - table->running;
+    if(queued > 0 && queued != table->reportedQueued) {
+        fprintf(stderr, "Fork server: %d jobs running, %d queued\n", table->running, queued);
+    }
+    table->reportedQueued = queued;
+}
+
+static void reap(struct job_table *table) {
+    pid_t pid;
+    int status;
+    while((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        struct job *job = NULL;
+        for(int i = 0; i < table->len; i++) {
+            if(table->jobs[i].state == JOB_RUNNING && table->jobs[i].pid == pid) {
+                job = &table->jobs[i];
+                break;
+            }
+        }
+        if(!job) {
+            // a pooled renderer that never got a job, pool_take notices it hung up
+            continue;
+        }
+        char desc[128];
+        job_describe(job, desc, sizeof(desc));
+        double sec = (get_time_usec() - job->startUsec) / 1e6;
+        if(job->cancelled) {
+            fprintf(stderr, "%s: cancelled after %.1f s\n", desc, sec);
+        } else if(WIFSIGNALED(status)) {
+            fprintf(stderr, "%s: crashed with %s after %.1f s\n", desc, strsignal(WTERMSIG(status)), sec);
+        } else if(WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: failed with exit status %d after %.1f s\n", desc, WEXITSTATUS(status), sec);
+        } else {
+            fprintf(stderr, "%s: finished after %.1f s\n", desc, sec);
+        }
+        table->running--;
+        job_remove(table, job);
+    }
+}
+
+static void cancel_all(struct job_table *table) {
+    for(int i = 0; i < table->len; ) {
+        struct job *job = &table->jobs[i];
+        if(job->state == JOB_QUEUED) {
+            char desc[128];
+            job_describe(job, desc, sizeof(desc));
+            fprintf(stderr, "%s: cancelled before it started\n", desc);
+            job_remove(table, job);
+            continue;
+        }
+        if(!job->cancelled) {
+            // the whole group, the algorithm child would otherwise only notice on its next pipe access
+            kill(-job->pid, SIGTERM);
+            job->cancelled = true;
+        }
+        i++;
+    }
+}
+
+struct usage_totals {
+    int runs;
+    double cpuSec;
+    long peakRssKb;
+    uint64_t ipcBytes;
+};
+
+static void report_run_usage(int status_read_fd, struct usage_totals *totals) {
+    struct run_usage usage;
+    read_(status_read_fd, (char*)&usage, sizeof(usage));
+    totals->runs++;
+    totals->cpuSec += usage.renderer.cpuSec + usage.algorithm.cpuSec;
+    if(usage.renderer.peakRssKb > totals->peakRssKb) totals->peakRssKb = usage.renderer.peakRssKb;
+    if(usage.algorithm.peakRssKb > totals->peakRssKb) totals->peakRssKb = usage.algorithm.peakRssKb;
+    totals->ipcBytes += usage.ipcBytes;
+    fprintf(stderr, "Fork server: %s done, %d runs so far, %.2f s CPU, %ld KB largest peak RSS, %" PRIu64 " KB over the pipes in total\n",
+        usage.algoName, totals->runs, totals->cpuSec, totals->peakRssKb, totals->ipcBytes >> 10);
+}
+
+// written to by the SIGCHLD handler, so poll wakes up to reap
+static int sigchld_fd = -1;
+
+static void on_sigchld(int sig) {
+    (void)sig;
+    int savedErrno = errno;
+    char c = 0;
+    // non-blocking, a full pipe already guarantees a wakeup
+    ssize_t written = write(sigchld_fd, &c, 1);
+    (void)written;
+    errno = savedErrno;
+}
+
+int launch_fork_server(int maxJobs) {
+    int fork_server_fd[2];
+    pipe_(fork_server_fd);
+    pid_t fork_server_pid = fork();
+    if(fork_server_pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if(fork_server_pid != 0) {
+        close_(fork_server_fd[0]);
+        return fork_server_fd[1];
+    }
+    close_(fork_server_fd[1]);
+    // every renderer writes a struct run_usage here when its sort ends
+    int status_fd[2];
+    pipe_(status_fd);
+    int wake_fd[2];
+    pipe_(wake_fd);
+    if(fcntl(wake_fd[1], F_SETFL, O_NONBLOCK) < 0) {
+        perror("fcntl");
+        exit(1);
+    }
+    sigchld_fd = wake_fd[1];
+    // the main window ignores SIGCHLD, the fork server reaps its jobs to report how they ended
+    signal(SIGCHLD, on_sigchld);
+
+    struct usage_totals totals = {0};
+    struct job_table table = { .maxRunning = maxJobs > 0 ? maxJobs : 1 };
+    struct pooled_renderer pool[RENDERER_POOL_LEN] = {0};
+    for(int i = 0; i < RENDERER_POOL_LEN; i++) {
+        pool_fill(pool, i, status_fd[1]);
+    }
+    struct sort_request req = {0};
+    while(1) {
+        struct pollfd fds[3] = {
+            { .fd = fork_server_fd[0], .events = POLLIN },
+            { .fd = status_fd[0], .events = POLLIN },
+            { .fd = wake_fd[0], .events = POLLIN },
+        };
+        if(poll(fds, 3, -1) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            exit(1);
+        }
+        if(fds[1].revents & POLLIN) {
+            report_run_usage(status_fd[0], &totals);
+        }
+        if(fds[2].revents & POLLIN) {
+            char drain[64];
+            if(read(wake_fd[0], drain, sizeof(drain)) < 0 && errno != EINTR) {
+                perror("read");
+                exit(1);
+            }
+            reap(&table);
+            schedule(&table, pool, status_fd[1]);
+        }
+        if(!(fds[0].revents & (POLLIN | POLLHUP))) {
+            continue;
+        }
+        read_request(fork_server_fd[0], &req);
+        if(req.algoSelection == REQUEST_EXIT) {
+            struct sort_request exitReq = { .algoSelection = REQUEST_EXIT };
+            for(int i = 0; i < RENDERER_POOL_LEN; i++) {
+                if(pool[i].pid) {
+                    write_request(pool[i].request_fd, &exitReq);
+                    pool_drop(&pool[i]);
+                }
+            }
+            close_(fork_server_fd[0]);
+            free(req.buf);
+            exit(0);
+        }
+        if(req.algoSelection == REQUEST_CANCEL_ALL) {
+            cancel_all(&table);
+            continue;
+        }
+        if(req.algoSelection != algo_count() - 1) {
+            job_add(&table, &req);
+        } else {
+            struct sort_request one = req;
+            for(int i = 0; i < algo_count() - 1; i++) {
+                if(!(algo_flags(i) & XSORT_CAP_NOT_IN_ALL)) {
+                    one.algoSelection = i;
+                    job_add(&table, &one);
+                }
+            }
+        }
+        schedule(&table, pool, status_fd[1]);
+    }
+}
@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include <time.h>
+
+// the order in which queued jobs are started, FIFO within the same priority
+enum job_priority { PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH, PRIORITIES_LEN };
+extern const char * const priority_names[PRIORITIES_LEN];
+
+// algoSelection values that are not an algorithm
+#define REQUEST_EXIT -1
+#define REQUEST_CANCEL_ALL -2
+
+// what LAUNCH sends to the fork server, and the fork server to a pooled renderer
+struct sort_request {
+    int algoSelection;
+    int64_t k;
+    int elemType;
+    enum job_priority priority;
+    // get_time_usec of the click, for the launch latency report
+    time_t launchUsec;
+    int64_t bufLen;
+    int64_t *buf;
+};
+
+void write_request(int fd, const struct sort_request *req);
+// forks the fork server and returns the write end of its request pipe
+// at most maxJobs renderers animate at once, further requests wait in a queue
+int launch_fork_server(int maxJobs);
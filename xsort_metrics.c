@@ -0,0 +1,168 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "xsort_metrics.h"
+
+static void fenwick_add(int *tree, int len, int idx, int delta) {
+    for(idx++; idx <= len; idx += idx & -idx) {
+        tree[idx - 1] += delta;
+    }
+}
+
+static int fenwick_prefix(const int *tree, int idx) {
+    // sum of the flags at [0, idx)
+    int sum = 0;
+    for(; idx > 0; idx -= idx & -idx) {
+        sum += tree[idx - 1];
+    }
+    return sum;
+}
+
+static int fenwick_find(const int *tree, int len, int target) {
+    // smallest idx with fenwick_prefix(tree, idx + 1) >= target, or len if there is none
+    int pos = 0;
+    int step = 1;
+    while(step * 2 <= len) {
+        step *= 2;
+    }
+    for(; step > 0; step /= 2) {
+        if(pos + step <= len && tree[pos + step - 1] < target) {
+            pos += step;
+            target -= tree[pos - 1];
+        }
+    }
+    return pos;
+}
+
+static int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t count_inversions(const int64_t *buf, int len) {
+    // Fenwick tree over value ranks: scanning right to left, count smaller values already seen
+    int64_t *sorted = malloc(len * sizeof(int64_t));
+    int *tree = calloc(len, sizeof(int));
+    if(!sorted || !tree) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(sorted, buf, len * sizeof(int64_t));
+    qsort(sorted, len, sizeof(int64_t), compare_int64);
+    int64_t inversions = 0;
+    for(int i = len - 1; i >= 0; i--) {
+        // rank of buf[i] is the first index of its value in sorted, so equal values are not counted
+        int lo = 0, hi = len;
+        while(lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if(sorted[mid] < buf[i]) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        inversions += fenwick_prefix(tree, lo);
+        fenwick_add(tree, len, lo, 1);
+    }
+    free(sorted);
+    free(tree);
+    return inversions;
+}
+
+static void set_descent(struct sort_metrics *m, int k) {
+    if(k < 0 || k >= m->len - 1) {
+        return;
+    }
+    bool descent = m->buf[k] > m->buf[k + 1];
+    if(descent != m->descent[k]) {
+        m->descent[k] = descent;
+        m->descents += descent ? 1 : -1;
+        fenwick_add(m->descentTree, m->len - 1, k, descent ? 1 : -1);
+    }
+}
+
+void metrics_init(struct sort_metrics *m, int64_t *buf, int len) {
+    m->buf = buf;
+    m->len = len;
+    m->inversions = m->initialInversions = count_inversions(buf, len);
+    m->descents = 0;
+    m->descent = calloc(len, sizeof(bool));
+    m->descentTree = calloc(len, sizeof(int));
+    if(!m->descent || !m->descentTree) {
+        perror("calloc");
+        exit(1);
+    }
+    for(int k = 0; k < len - 1; k++) {
+        set_descent(m, k);
+    }
+}
+
+void metrics_free(struct sort_metrics *m) {
+    free(m->descent);
+    free(m->descentTree);
+}
+
+void metrics_swap(struct sort_metrics *m, int i, int j) {
+    // swaps buf[i] and buf[j] and updates the metrics
+    if(i == j) {
+        return;
+    }
+    if(i > j) {
+        int tmp = i;
+        i = j;
+        j = tmp;
+    }
+    int64_t a = m->buf[i];
+    int64_t b = m->buf[j];
+    if(a != b) {
+        // only pairs involving i or j change; for an element c between them, the pair count
+        // changes by 2 if c is strictly between a and b, by 1 if c equals one of them
+        // adjacent swaps (most swaps of bubble and insertion sort) skip the scan entirely
+        int64_t lo = a < b ? a : b;
+        int64_t hi = a < b ? b : a;
+        int64_t delta = 1;
+        for(int k = i + 1; k < j; k++) {
+            int64_t c = m->buf[k];
+            if(c > lo && c < hi) {
+                delta += 2;
+            } else if(c == lo || c == hi) {
+                delta += 1;
+            }
+        }
+        m->inversions += a < b ? delta : -delta;
+    }
+    m->buf[i] = b;
+    m->buf[j] = a;
+    set_descent(m, i - 1);
+    set_descent(m, i);
+    set_descent(m, j - 1);
+    set_descent(m, j);
+}
+
+int metrics_runs(const struct sort_metrics *m) {
+    return m->len == 0 ? 0 : m->descents + 1;
+}
+
+int metrics_sorted_prefix(const struct sort_metrics *m) {
+    if(m->descents == 0) {
+        return m->len;
+    }
+    return fenwick_find(m->descentTree, m->len - 1, 1) + 1;
+}
+
+int metrics_sorted_suffix(const struct sort_metrics *m) {
+    if(m->descents == 0) {
+        return m->len;
+    }
+    int last = fenwick_find(m->descentTree, m->len - 1, m->descents);
+    return m->len - 1 - last;
+}
+
+bool metrics_sorted(const struct sort_metrics *m) {
+    return m->descents == 0;
+}
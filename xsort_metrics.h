@@ -0,0 +1,22 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+// sortedness of the buffer being animated, updated on every swap instead of rescanning
+struct sort_metrics {
+    int64_t *buf;
+    int len;
+    int64_t inversions;
+    int64_t initialInversions;
+    int descents;
+    // descent[k] is set when buf[k] > buf[k + 1], descentTree is a Fenwick tree over those flags
+    bool *descent;
+    int *descentTree;
+};
+
+void metrics_init(struct sort_metrics *m, int64_t *buf, int len);
+void metrics_free(struct sort_metrics *m);
+void metrics_swap(struct sort_metrics *m, int i, int j);
+int metrics_runs(const struct sort_metrics *m);
+int metrics_sorted_prefix(const struct sort_metrics *m);
+int metrics_sorted_suffix(const struct sort_metrics *m);
+bool metrics_sorted(const struct sort_metrics *m);
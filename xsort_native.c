@@ -0,0 +1,726 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils.h"
+#include "xsort_tuning.h"
+#include "xsort_native.h"
+
+static int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void native_qsort(int64_t *buf, int64_t len) {
+    qsort(buf, len, sizeof(int64_t), compare_int64);
+}
+
+static void swap_ptr(int64_t *a, int64_t *b) {
+    int64_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static int log2_floor(int64_t len) {
+    int log = 0;
+    while(len > 1) {
+        len >>= 1;
+        log++;
+    }
+    return log;
+}
+
+static void native_sift_down(int64_t *buf, int64_t len, int64_t i) {
+    while(1) {
+        int64_t child1 = i * 2 + 1;
+        int64_t child2 = i * 2 + 2;
+        int64_t largest = i;
+        if(child1 < len && buf[largest] < buf[child1]) {
+            largest = child1;
+        }
+        if(child2 < len && buf[largest] < buf[child2]) {
+            largest = child2;
+        }
+        if(largest == i) {
+            break;
+        }
+        swap_ptr(&buf[i], &buf[largest]);
+        i = largest;
+    }
+}
+
+static void native_heap_sort(int64_t *buf, int64_t len) {
+    for(int64_t i = (len - 2) / 2; i >= 0; i--) {
+        native_sift_down(buf, len, i);
+    }
+    for(int64_t i = len - 1; i > 0; i--) {
+        swap_ptr(&buf[0], &buf[i]);
+        native_sift_down(buf, i, 0);
+    }
+}
+
+// pattern-defeating quicksort, following the structure of Orson Peters' pdqsort
+
+#define PDQ_NINTHER_THRESHOLD 128
+#define PDQ_PARTIAL_INSERTION_SORT_LIMIT 8
+
+static void insertion_sort(int64_t *begin, int64_t *end) {
+    if(begin == end) {
+        return;
+    }
+    for(int64_t *cur = begin + 1; cur != end; cur++) {
+        int64_t tmp = *cur;
+        int64_t *sift = cur;
+        while(sift != begin && tmp < sift[-1]) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = tmp;
+    }
+}
+
+static void unguarded_insertion_sort(int64_t *begin, int64_t *end) {
+    // the element before begin is known to be smaller or equal to everything in [begin, end)
+    if(begin == end) {
+        return;
+    }
+    for(int64_t *cur = begin + 1; cur != end; cur++) {
+        int64_t tmp = *cur;
+        int64_t *sift = cur;
+        while(tmp < sift[-1]) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = tmp;
+    }
+}
+
+static bool partial_insertion_sort(int64_t *begin, int64_t *end) {
+    // insertion sort which gives up after moving too many elements
+    if(begin == end) {
+        return true;
+    }
+    int64_t limit = 0;
+    for(int64_t *cur = begin + 1; cur != end; cur++) {
+        int64_t *sift = cur;
+        if(*sift < sift[-1]) {
+            int64_t tmp = *sift;
+            do {
+                *sift = sift[-1];
+                sift--;
+            } while(sift != begin && tmp < sift[-1]);
+            *sift = tmp;
+            limit += cur - sift;
+        }
+        if(limit > PDQ_PARTIAL_INSERTION_SORT_LIMIT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void sort2(int64_t *a, int64_t *b) {
+    if(*b < *a) {
+        swap_ptr(a, b);
+    }
+}
+
+static void sort3(int64_t *a, int64_t *b, int64_t *c) {
+    sort2(a, b);
+    sort2(b, c);
+    sort2(a, b);
+}
+
+static int64_t *partition_right(int64_t *begin, int64_t *end, bool *already_partitioned) {
+    // elements equal to the pivot go to the right
+    int64_t pivot = *begin;
+    int64_t *first = begin;
+    int64_t *last = end;
+    while(*++first < pivot);
+    if(first - 1 == begin) {
+        while(first < last && !(*--last < pivot));
+    } else {
+        while(!(*--last < pivot));
+    }
+    *already_partitioned = first >= last;
+    while(first < last) {
+        swap_ptr(first, last);
+        while(*++first < pivot);
+        while(!(*--last < pivot));
+    }
+    int64_t *pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+static int64_t *partition_right_block(int64_t *begin, int64_t *end, bool *already_partitioned) {
+    // same contract as partition_right, but BlockQuicksort style: the comparison outcomes of a whole
+    // block are first stored as offsets of misplaced elements without branching on the data,
+    // then the misplaced elements of the left and right blocks are swapped in a batch
+    int64_t pivot = *begin;
+    int64_t *first = begin;
+    int64_t *last = end;
+    while(*++first < pivot);
+    if(first - 1 == begin) {
+        while(first < last && !(*--last < pivot));
+    } else {
+        while(!(*--last < pivot));
+    }
+    *already_partitioned = first >= last;
+    if(!*already_partitioned) {
+        swap_ptr(first, last);
+        first++;
+    }
+    // now [begin + 1, first) < pivot and [last, end) >= pivot
+    // block size comes from tuning, offsets are stored in unsigned chars
+    const int block = tuning.nativeBlockSize;
+    unsigned char offsetsL[TUNING_MAX_BLOCK_SIZE], offsetsR[TUNING_MAX_BLOCK_SIZE];
+    int numL = 0, numR = 0, startL = 0, startR = 0;
+    while(last - first >= 2 * block) {
+        if(numL == 0) {
+            startL = 0;
+            for(int64_t i = 0; i < block; i++) {
+                offsetsL[numL] = i;
+                numL += !(first[i] < pivot);
+            }
+        }
+        if(numR == 0) {
+            startR = 0;
+            for(int64_t i = 0; i < block; i++) {
+                offsetsR[numR] = i + 1;
+                numR += last[-1 - i] < pivot;
+            }
+        }
+        int num = numL < numR ? numL : numR;
+        for(int64_t k = 0; k < num; k++) {
+            swap_ptr(first + offsetsL[startL + k], last - offsetsR[startR + k]);
+        }
+        numL -= num;
+        numR -= num;
+        startL += num;
+        startR += num;
+        if(numL == 0) {
+            first += block;
+        }
+        if(numR == 0) {
+            last -= block;
+        }
+    }
+    // the rest, including a block which still has misplaced elements, is done one element at a time
+    while(first < last) {
+        if(*first < pivot) {
+            first++;
+        } else {
+            swap_ptr(first, --last);
+        }
+    }
+    int64_t *pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+static int64_t *partition_left(int64_t *begin, int64_t *end) {
+    // elements equal to the pivot go to the left, used when the pivot equals the element before the range
+    int64_t pivot = *begin;
+    int64_t *first = begin;
+    int64_t *last = end;
+    while(pivot < *--last);
+    if(last + 1 == end) {
+        while(first < last && !(pivot < *++first));
+    } else {
+        while(!(pivot < *++first));
+    }
+    while(first < last) {
+        swap_ptr(first, last);
+        while(pivot < *--last);
+        while(!(pivot < *++first));
+    }
+    int64_t *pivot_pos = last;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+static void pdqsort_loop(int64_t *begin, int64_t *end, int bad_allowed, bool leftmost, bool block) {
+    while(1) {
+        int64_t size = end - begin;
+        if(size < tuning.nativeInsertionCutoff) {
+            if(leftmost) {
+                insertion_sort(begin, end);
+            } else {
+                unguarded_insertion_sort(begin, end);
+            }
+            return;
+        }
+
+        int64_t s2 = size / 2;
+        if(size > PDQ_NINTHER_THRESHOLD) {
+            // pseudo-median of 9 (Tukey's ninther), moved to *begin
+            sort3(begin, begin + s2, end - 1);
+            sort3(begin + 1, begin + (s2 - 1), end - 2);
+            sort3(begin + 2, begin + (s2 + 1), end - 3);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1));
+            swap_ptr(begin, begin + s2);
+        } else {
+            sort3(begin + s2, begin, end - 1);
+        }
+
+        if(!leftmost && !(begin[-1] < *begin)) {
+            // pivot equals an element to the left, so every element equal to it is already in place
+            begin = partition_left(begin, end) + 1;
+            continue;
+        }
+
+        bool already_partitioned;
+        int64_t *pivot_pos = block ? partition_right_block(begin, end, &already_partitioned) : partition_right(begin, end, &already_partitioned);
+        int64_t l_size = pivot_pos - begin;
+        int64_t r_size = end - (pivot_pos + 1);
+        bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+        if(highly_unbalanced) {
+            if(--bad_allowed == 0) {
+                native_heap_sort(begin, end - begin);
+                return;
+            }
+            // break up patterns which may be causing the bad partitions
+            if(l_size >= tuning.nativeInsertionCutoff) {
+                swap_ptr(begin, begin + l_size / 4);
+                swap_ptr(pivot_pos - 1, pivot_pos - l_size / 4);
+                if(l_size > PDQ_NINTHER_THRESHOLD) {
+                    swap_ptr(begin + 1, begin + (l_size / 4 + 1));
+                    swap_ptr(begin + 2, begin + (l_size / 4 + 2));
+                    swap_ptr(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    swap_ptr(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if(r_size >= tuning.nativeInsertionCutoff) {
+                swap_ptr(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                swap_ptr(end - 1, end - r_size / 4);
+                if(r_size > PDQ_NINTHER_THRESHOLD) {
+                    swap_ptr(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    swap_ptr(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    swap_ptr(end - 2, end - (1 + r_size / 4));
+                    swap_ptr(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if(already_partitioned && partial_insertion_sort(begin, pivot_pos) && partial_insertion_sort(pivot_pos + 1, end)) {
+            // the input was likely already sorted, and the optimistic insertion sorts confirmed it
+            return;
+        }
+
+        pdqsort_loop(begin, pivot_pos, bad_allowed, leftmost, block);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+void native_pdqsort(int64_t *buf, int64_t len) {
+    if(len < 2) {
+        return;
+    }
+    pdqsort_loop(buf, buf + len, log2_floor(len), true, false);
+}
+
+void native_block_quicksort(int64_t *buf, int64_t len) {
+    // pdqsort with the branchless block partition
+    if(len < 2) {
+        return;
+    }
+    pdqsort_loop(buf, buf + len, log2_floor(len), true, true);
+}
+
+// sorting networks: every comparator puts the minimum at the lower index, and a stage is a set of
+// disjoint comparators, so a stage runs as min/max over whole runs of elements
+
+static inline void cx(int64_t *a, int64_t *b) {
+    int64_t x = *a, y = *b;
+    *a = x < y ? x : y;
+    *b = x < y ? y : x;
+}
+
+struct network_kernels {
+    // x[t] against y[t] for t < len
+    void (*run)(int64_t *x, int64_t *y, int64_t len);
+    // x[t] against x[2 * half - 1 - t] for t < half, the first stage of a bitonic merge
+    void (*flip)(int64_t *x, int64_t half);
+    // distance 2 and then distance 1 inside every group of 4, the last two stages of a bitonic merge
+    void (*clean4)(int64_t *x, int64_t len);
+};
+
+static void cx_run_scalar(int64_t *x, int64_t *y, int64_t len) {
+    for(int64_t t = 0; t < len; t++) {
+        cx(&x[t], &y[t]);
+    }
+}
+
+static void cx_flip_scalar(int64_t *x, int64_t half) {
+    for(int64_t t = 0; t < half; t++) {
+        cx(&x[t], &x[2 * half - 1 - t]);
+    }
+}
+
+static void cx_clean4_scalar(int64_t *x, int64_t len) {
+    for(int64_t i = 0; i < len; i += 4) {
+        cx(&x[i], &x[i + 2]);
+        cx(&x[i + 1], &x[i + 3]);
+        cx(&x[i], &x[i + 1]);
+        cx(&x[i + 2], &x[i + 3]);
+    }
+}
+
+static const struct network_kernels scalar_kernels = { cx_run_scalar, cx_flip_scalar, cx_clean4_scalar };
+
+static void bitonic_network(int64_t *buf, int64_t n, const struct network_kernels *kernels) {
+    // n is a power of two
+    for(int64_t k = 2; k <= n; k *= 2) {
+        for(int64_t block = 0; block < n; block += k) {
+            kernels->flip(buf + block, k / 2);
+        }
+        int64_t j = k / 4;
+        for(; j >= 4; j /= 2) {
+            for(int64_t i = 0; i < n; i += 2 * j) {
+                kernels->run(buf + i, buf + i + j, j);
+            }
+        }
+        if(j == 2) {
+            kernels->clean4(buf, n);
+        } else if(j == 1) {
+            for(int64_t i = 0; i < n; i += 2) {
+                cx(&buf[i], &buf[i + 1]);
+            }
+        }
+    }
+}
+
+static void odd_even_merge_network(int64_t *buf, int64_t len, const struct network_kernels *kernels) {
+    // Batcher's network, the comparators of a (p, k) stage come in runs of k that either all
+    // stay inside a block of 2p or all cross its boundary, so whole runs are kept or skipped
+    for(int64_t p = 1; p < len; p *= 2) {
+        for(int64_t k = p; k >= 1; k /= 2) {
+            for(int64_t j = k % p; j + k < len; j += 2 * k) {
+                if(j / (2 * p) != (j + k) / (2 * p)) {
+                    continue;
+                }
+                int64_t runLen = i64_min(k, len - j - k);
+                if(runLen < 4) {
+                    // too short for a vector, not worth the indirect call
+                    for(int64_t t = 0; t < runLen; t++) {
+                        cx(&buf[j + t], &buf[j + k + t]);
+                    }
+                } else {
+                    kernels->run(buf + j, buf + j + k, runLen);
+                }
+            }
+        }
+    }
+}
+
+// vectorized quicksort: AVX2 partition with a permutation lookup table, sorting networks for the leaves
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_SORT 1
+#define AVX2 __attribute__((target("avx2")))
+
+static int32_t partition_lut[16][8];
+static bool partition_lut_ready = false;
+
+static void init_partition_lut(void) {
+    // for each 4-bit mask, a permutation moving the selected 64-bit lanes to the front, keeping the rest after them
+    for(int mask = 0; mask < 16; mask++) {
+        int out = 0;
+        for(int pass = 0; pass < 2; pass++) {
+            for(int lane = 0; lane < 4; lane++) {
+                bool selected = (mask >> lane) & 1;
+                if(selected == (pass == 0)) {
+                    partition_lut[mask][out * 2] = lane * 2;
+                    partition_lut[mask][out * 2 + 1] = lane * 2 + 1;
+                    out++;
+                }
+            }
+        }
+    }
+    partition_lut_ready = true;
+}
+
+static inline AVX2 __m256i v_min(__m256i a, __m256i b) {
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+static inline AVX2 __m256i v_max(__m256i a, __m256i b) {
+    return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+static inline AVX2 __m256i v_reverse(__m256i v) {
+    return _mm256_permute4x64_epi64(v, 0x1B);
+}
+
+static inline AVX2 __m256i v_bitonic_clean(__m256i v) {
+    // sorts a bitonic sequence of 4 lanes: compare at distance 2, then at distance 1
+    __m256i t = _mm256_permute4x64_epi64(v, 0x4E);
+    v = _mm256_blend_epi32(v_min(v, t), v_max(v, t), 0xF0);
+    t = _mm256_permute4x64_epi64(v, 0xB1);
+    v = _mm256_blend_epi32(v_min(v, t), v_max(v, t), 0xCC);
+    return v;
+}
+
+static inline AVX2 void v_merge4(__m256i *a, __m256i *b) {
+    // merges two sorted registers, *a gets the 4 smallest elements
+    __m256i rb = v_reverse(*b);
+    __m256i lo = v_min(*a, rb);
+    __m256i hi = v_max(*a, rb);
+    *a = v_bitonic_clean(lo);
+    *b = v_bitonic_clean(hi);
+}
+
+static inline AVX2 void v_merge8(__m256i *a0, __m256i *a1, __m256i *b0, __m256i *b1) {
+    // merges two sorted runs of 8 elements held in 2 registers each
+    __m256i rb0 = v_reverse(*b1);
+    __m256i rb1 = v_reverse(*b0);
+    __m256i l0 = v_min(*a0, rb0), l1 = v_min(*a1, rb1);
+    __m256i h0 = v_max(*a0, rb0), h1 = v_max(*a1, rb1);
+    *a0 = v_bitonic_clean(v_min(l0, l1));
+    *a1 = v_bitonic_clean(v_max(l0, l1));
+    *b0 = v_bitonic_clean(v_min(h0, h1));
+    *b1 = v_bitonic_clean(v_max(h0, h1));
+}
+
+static inline AVX2 void v_compare_exchange(__m256i *a, __m256i *b) {
+    __m256i lo = v_min(*a, *b);
+    *b = v_max(*a, *b);
+    *a = lo;
+}
+
+static AVX2 void cx_run_avx2(int64_t *x, int64_t *y, int64_t len) {
+    int64_t t = 0;
+    for(; t + 4 <= len; t += 4) {
+        __m256i a = _mm256_loadu_si256((__m256i*)(x + t));
+        __m256i b = _mm256_loadu_si256((__m256i*)(y + t));
+        _mm256_storeu_si256((__m256i*)(x + t), v_min(a, b));
+        _mm256_storeu_si256((__m256i*)(y + t), v_max(a, b));
+    }
+    cx_run_scalar(x + t, y + t, len - t);
+}
+
+static AVX2 void cx_flip_avx2(int64_t *x, int64_t half) {
+    int64_t t = 0;
+    for(; t + 4 <= half; t += 4) {
+        int64_t *hi = x + 2 * half - 4 - t;
+        __m256i a = _mm256_loadu_si256((__m256i*)(x + t));
+        __m256i b = v_reverse(_mm256_loadu_si256((__m256i*)hi));
+        _mm256_storeu_si256((__m256i*)(x + t), v_min(a, b));
+        _mm256_storeu_si256((__m256i*)hi, v_reverse(v_max(a, b)));
+    }
+    for(; t < half; t++) {
+        cx(&x[t], &x[2 * half - 1 - t]);
+    }
+}
+
+static AVX2 void cx_clean4_avx2(int64_t *x, int64_t len) {
+    for(int64_t i = 0; i < len; i += 4) {
+        __m256i v = _mm256_loadu_si256((__m256i*)(x + i));
+        _mm256_storeu_si256((__m256i*)(x + i), v_bitonic_clean(v));
+    }
+}
+
+static const struct network_kernels avx2_kernels = { cx_run_avx2, cx_flip_avx2, cx_clean4_avx2 };
+
+static AVX2 void avx2_sort16(int64_t *buf, int64_t len) {
+    int64_t tmp[16];
+    for(int64_t i = 0; i < 16; i++) {
+        tmp[i] = i < len ? buf[i] : INT64_MAX;
+    }
+    __m256i r0 = _mm256_loadu_si256((__m256i*)(tmp + 0));
+    __m256i r1 = _mm256_loadu_si256((__m256i*)(tmp + 4));
+    __m256i r2 = _mm256_loadu_si256((__m256i*)(tmp + 8));
+    __m256i r3 = _mm256_loadu_si256((__m256i*)(tmp + 12));
+
+    // sort the 4 columns with a 5 comparator network
+    v_compare_exchange(&r0, &r1);
+    v_compare_exchange(&r2, &r3);
+    v_compare_exchange(&r0, &r2);
+    v_compare_exchange(&r1, &r3);
+    v_compare_exchange(&r1, &r2);
+
+    // transpose so each register holds a sorted run of 4
+    __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+    r0 = _mm256_permute2x128_si256(t0, t2, 0x20);
+    r1 = _mm256_permute2x128_si256(t1, t3, 0x20);
+    r2 = _mm256_permute2x128_si256(t0, t2, 0x31);
+    r3 = _mm256_permute2x128_si256(t1, t3, 0x31);
+
+    v_merge4(&r0, &r1);
+    v_merge4(&r2, &r3);
+    v_merge8(&r0, &r1, &r2, &r3);
+
+    _mm256_storeu_si256((__m256i*)(tmp + 0), r0);
+    _mm256_storeu_si256((__m256i*)(tmp + 4), r1);
+    _mm256_storeu_si256((__m256i*)(tmp + 8), r2);
+    _mm256_storeu_si256((__m256i*)(tmp + 12), r3);
+    memcpy(buf, tmp, len * sizeof(int64_t));
+}
+
+static inline AVX2 int partition_mask(__m256i v, __m256i pv, bool or_equal) {
+    if(or_equal) {
+        return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, pv))) & 0xF;
+    }
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(pv, v)));
+}
+
+static AVX2 int64_t avx2_partition(int64_t *buf, int64_t len, int64_t pivot, bool or_equal) {
+    // moves elements < pivot (or <= pivot) to the front and returns their count, requires len >= 16
+    // every vector is stored to both write cursors, which is safe because at least 4 slots are always free on both sides
+    __m256i pv = _mm256_set1_epi64x(pivot);
+    int64_t saved[8 + 4];
+    _mm256_storeu_si256((__m256i*)(saved + 0), _mm256_loadu_si256((__m256i*)buf));
+    _mm256_storeu_si256((__m256i*)(saved + 4), _mm256_loadu_si256((__m256i*)(buf + len - 4)));
+    int64_t readL = 4, readR = len - 4;
+    int64_t writeL = 0, writeR = len;
+    while(readR - readL >= 4) {
+        __m256i v;
+        if(readL - writeL <= writeR - readR) {
+            v = _mm256_loadu_si256((__m256i*)(buf + readL));
+            readL += 4;
+        } else {
+            readR -= 4;
+            v = _mm256_loadu_si256((__m256i*)(buf + readR));
+        }
+        int mask = partition_mask(v, pv, or_equal);
+        int count = __builtin_popcount(mask);
+        __m256i perm = _mm256_loadu_si256((__m256i*)partition_lut[mask]);
+        v = _mm256_permutevar8x32_epi32(v, perm);
+        _mm256_storeu_si256((__m256i*)(buf + writeL), v);
+        writeL += count;
+        _mm256_storeu_si256((__m256i*)(buf + writeR - 4), v);
+        writeR -= 4 - count;
+    }
+    // the saved edge vectors and the unread tail fill exactly the remaining gap
+    int savedLen = 8;
+    for(int64_t i = readL; i < readR; i++) {
+        saved[savedLen++] = buf[i];
+    }
+    for(int64_t i = 0; i < savedLen; i++) {
+        int64_t x = saved[i];
+        if(x < pivot || (or_equal && x == pivot)) {
+            buf[writeL++] = x;
+        } else {
+            buf[--writeR] = x;
+        }
+    }
+    return writeL;
+}
+
+static AVX2 void avx2_sort_rec(int64_t *buf, int64_t len, int depth) {
+    while(len > 16) {
+        if(depth-- == 0) {
+            native_heap_sort(buf, len);
+            return;
+        }
+        int64_t a = buf[0], b = buf[len / 2], c = buf[len - 1];
+        int64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+        int64_t split = avx2_partition(buf, len, pivot, false);
+        if(split == 0) {
+            // pivot is the minimum, every element equal to it is already in its final place
+            split = avx2_partition(buf, len, pivot, true);
+            buf += split;
+            len -= split;
+            continue;
+        }
+        // recurse into the smaller side to bound stack depth
+        if(split < len - split) {
+            avx2_sort_rec(buf, split, depth);
+            buf += split;
+            len -= split;
+        } else {
+            avx2_sort_rec(buf + split, len - split, depth);
+            len = split;
+        }
+    }
+    avx2_sort16(buf, len);
+}
+#endif
+
+bool native_avx2_available(void) {
+#ifdef HAVE_AVX2_SORT
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void native_avx2_sort(int64_t *buf, int64_t len) {
+#ifdef HAVE_AVX2_SORT
+    if(native_avx2_available()) {
+        if(!partition_lut_ready) {
+            init_partition_lut();
+        }
+        avx2_sort_rec(buf, len, 2 * log2_floor(len) + 1);
+        return;
+    }
+#endif
+    // scalar fallback when the CPU lacks AVX2
+    native_pdqsort(buf, len);
+}
+
+static const struct network_kernels *network_kernels(void) {
+#ifdef HAVE_AVX2_SORT
+    if(native_avx2_available()) {
+        return &avx2_kernels;
+    }
+#endif
+    return &scalar_kernels;
+}
+
+void native_bitonic_sort(int64_t *buf, int64_t len) {
+    int64_t n = 1;
+    while(n < len) {
+        n *= 2;
+    }
+    if(n == len) {
+        bitonic_network(buf, n, network_kernels());
+        return;
+    }
+    // padding with the largest key keeps every comparator that reaches past len a no-op
+    int64_t *padded = malloc(n * sizeof(int64_t));
+    if(!padded) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(padded, buf, len * sizeof(int64_t));
+    for(int64_t i = len; i < n; i++) {
+        padded[i] = INT64_MAX;
+    }
+    bitonic_network(padded, n, network_kernels());
+    memcpy(buf, padded, len * sizeof(int64_t));
+    free(padded);
+}
+
+void native_odd_even_merge_sort(int64_t *buf, int64_t len) {
+    odd_even_merge_network(buf, len, network_kernels());
+}
+
+const native_sort native_algos[NATIVE_LEN] = {
+    native_qsort,
+    native_pdqsort,
+    native_block_quicksort,
+    native_avx2_sort,
+    native_bitonic_sort,
+    native_odd_even_merge_sort,
+};
+const char * const native_names[NATIVE_LEN] = {
+    "libc qsort",
+    "pdqsort",
+    "BlockQuicksort",
+    "AVX2 Sort",
+    "Bitonic Network",
+    "Odd-Even Network",
+};
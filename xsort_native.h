@@ -0,0 +1,17 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+// non-instrumented sorts that work directly on the buffer, used as benchmark baselines
+void native_qsort(int64_t *buf, int64_t len);
+void native_pdqsort(int64_t *buf, int64_t len);
+void native_block_quicksort(int64_t *buf, int64_t len);
+void native_avx2_sort(int64_t *buf, int64_t len);
+bool native_avx2_available(void);
+// sorting networks, stage by stage with AVX2 min/max when available
+void native_bitonic_sort(int64_t *buf, int64_t len);
+void native_odd_even_merge_sort(int64_t *buf, int64_t len);
+
+typedef void (*native_sort)(int64_t *, int64_t);
+extern const native_sort native_algos[];
+extern const char * const native_names[];
+#define NATIVE_LEN 6
@@ -0,0 +1,42 @@
+// Interface for sort algorithm plugins loaded from .so files at startup.
+//
+// A plugin exports a descriptor named XSORT_PLUGIN_SYMBOL:
+//     const struct xsort_plugin xsort_plugin_descriptor = {
+//         .abi_version = XSORT_PLUGIN_ABI_VERSION,
+//         .name = "My Sort",
+//         .sort = my_sort,
+//         .flags = 0,
+//     };
+// The sort function only sees the buffer through api->smaller and api->swap, exactly like the
+// built-in algorithms, so it runs unchanged in the visual renderer and in the headless benchmark.
+// Plugins are searched in $XSORT_PLUGIN_DIR, or ./plugins when it is not set.
+#ifndef XSORT_PLUGIN_H
+#define XSORT_PLUGIN_H
+
+#include <stdint.h>
+
+// version 2 made indices and lengths 64-bit
+#define XSORT_PLUGIN_ABI_VERSION 2
+#define XSORT_PLUGIN_SYMBOL "xsort_plugin_descriptor"
+
+// capability flags, shared with the built-in algorithms
+// quadratic algorithms are skipped by the benchmark for large inputs
+#define XSORT_CAP_QUADRATIC (1u << 0)
+// not launched by the "All" selection
+#define XSORT_CAP_NOT_IN_ALL (1u << 1)
+
+struct xsort_plugin_api {
+    // is buffer[i] < buffer[j]? never returns if the window was closed
+    int (*smaller)(void *ctx, int64_t i, int64_t j);
+    void (*swap)(void *ctx, int64_t i, int64_t j);
+    void *ctx;
+};
+
+struct xsort_plugin {
+    uint32_t abi_version;
+    const char *name;
+    void (*sort)(const struct xsort_plugin_api *api, int64_t len);
+    uint32_t flags;
+};
+
+#endif
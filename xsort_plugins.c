@@ -0,0 +1,95 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <dirent.h>
+#include <dlfcn.h>
+
+#include "xsort_plugins.h"
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static const struct xsort_plugin *load_plugin(const char *path) {
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(!handle) {
+        fprintf(stderr, "Failed to load plugin: %s\n", dlerror());
+        return NULL;
+    }
+    const struct xsort_plugin *plugin = dlsym(handle, XSORT_PLUGIN_SYMBOL);
+    if(!plugin) {
+        fprintf(stderr, "%s: no %s symbol\n", path, XSORT_PLUGIN_SYMBOL);
+        dlclose(handle);
+        return NULL;
+    }
+    if(plugin->abi_version != XSORT_PLUGIN_ABI_VERSION) {
+        fprintf(stderr, "%s: plugin ABI version %u, expected %d\n", path, plugin->abi_version, XSORT_PLUGIN_ABI_VERSION);
+        dlclose(handle);
+        return NULL;
+    }
+    if(!plugin->name || !plugin->sort) {
+        fprintf(stderr, "%s: descriptor is missing a name or entry point\n", path);
+        dlclose(handle);
+        return NULL;
+    }
+    // the handle stays open for the lifetime of the process
+    return plugin;
+}
+
+const struct xsort_plugin **plugins_load(const char *dir, int *len) {
+    *len = 0;
+    DIR *d = opendir(dir);
+    if(!d) {
+        // no plugin directory is the normal case
+        return NULL;
+    }
+    char **names = NULL;
+    int namesLen = 0;
+    struct dirent *entry;
+    while((entry = readdir(d)) != NULL) {
+        size_t nameLen = strlen(entry->d_name);
+        if(nameLen < 4 || strcmp(entry->d_name + nameLen - 3, ".so") != 0) {
+            continue;
+        }
+        char **names_ = reallocarray(names, namesLen + 1, sizeof(char*));
+        if(!names_) {
+            perror("reallocarray");
+            exit(1);
+        }
+        names = names_;
+        names[namesLen] = strdup(entry->d_name);
+        if(!names[namesLen]) {
+            perror("strdup");
+            exit(1);
+        }
+        namesLen++;
+    }
+    closedir(d);
+    if(namesLen == 0) {
+        // a fresh checkout has plugins/ with the sources only
+        return NULL;
+    }
+    // readdir order is arbitrary, keep the radio buttons stable between runs
+    qsort(names, namesLen, sizeof(char*), compare_names);
+
+    const struct xsort_plugin **plugins = calloc(namesLen, sizeof(struct xsort_plugin*));
+    if(!plugins) {
+        perror("calloc");
+        exit(1);
+    }
+    for(int i = 0; i < namesLen; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        const struct xsort_plugin *plugin = load_plugin(path);
+        if(plugin) {
+            fprintf(stderr, "Loaded plugin \"%s\" from %s\n", plugin->name, path);
+            plugins[(*len)++] = plugin;
+        }
+        free(names[i]);
+    }
+    free(names);
+    return plugins;
+}
@@ -0,0 +1,4 @@
+#include "xsort_plugin.h"
+
+// loads every .so in dir that exports a descriptor with a matching ABI version, in file name order
+const struct xsort_plugin **plugins_load(const char *dir, int *len);
@@ -0,0 +1,42 @@
+// Wire format spoken on the UNIX domain socket opened by "xsort --listen PATH".
+//
+// An external process connects to the socket, uploads the buffer to be sorted and then drives
+// the renderer with the same compare and swap operations the built-in algorithms use.
+// All integers are little-endian and unsigned unless noted, indices are 0-based.
+//
+// Every client frame starts with a 5 byte header:
+//     u8  type      XSORT_FRAME_HELLO or XSORT_FRAME_OPS
+//     u32 length    number of payload bytes that follow
+//
+// HELLO, sent once right after connecting:
+//     u32 version   XSORT_PROTOCOL_VERSION
+//     u16 name_len  followed by name_len bytes of algorithm name, shown in the window title
+//     u32 count     followed by count signed 64-bit values, the buffer to sort
+// The whole HELLO payload, 10 + name_len + count * 8 bytes, must fit in XSORT_MAX_FRAME,
+// which limits count to a little under 8.4 million values.
+// The server answers with a u32 holding its own protocol version, or closes the connection.
+//
+// OPS, a batch of operations executed in order:
+//     u8 opcode, then its operands:
+//     XSORT_OP_COMPARE  u32 i, u32 j   is buffer[i] < buffer[j]?
+//     XSORT_OP_SWAP     u32 i, u32 j   swap buffer[i] and buffer[j], animated
+//     XSORT_OP_FINISH                  the sort is done, no more frames follow
+// Compares see the effect of every swap before them, including swaps earlier in the same batch.
+// If a batch contains at least one compare, the server answers it with:
+//     u32 count     number of compares in the batch
+//     u8  result    count times, 1 if the compare was true, 0 otherwise
+// Batches without compares get no answer, so swaps can be streamed without waiting.
+//
+// The server closes the connection when the window is closed before the sort finished,
+// or when a frame is malformed or an index is out of range.
+
+#define XSORT_PROTOCOL_VERSION 1
+// frames larger than this are rejected
+#define XSORT_MAX_FRAME (64 << 20)
+
+#define XSORT_FRAME_HELLO 1
+#define XSORT_FRAME_OPS 2
+
+#define XSORT_OP_COMPARE 0
+#define XSORT_OP_SWAP 1
+#define XSORT_OP_FINISH 2
@@ -0,0 +1,276 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "xsort_subproc.h"
+#include "xsort_protocol.h"
+#include "xsort_socket.h"
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static bool recv_all(int fd, void *buf, size_t len) {
+    // false on EOF or error, the client is gone either way
+    char *p = buf;
+    while(len > 0) {
+        ssize_t bytes = recv(fd, p, len, 0);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("recv");
+            return false;
+        }
+        if(bytes == 0) {
+            return false;
+        }
+        p += bytes;
+        len -= bytes;
+    }
+    return true;
+}
+
+static bool send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while(len > 0) {
+        ssize_t bytes = send(fd, p, len, MSG_NOSIGNAL);
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+            perror("send");
+            return false;
+        }
+        p += bytes;
+        len -= bytes;
+    }
+    return true;
+}
+
+static bool recv_frame(int fd, int *type, uint8_t **payload, uint32_t *len) {
+    uint8_t header[5];
+    if(!recv_all(fd, header, sizeof(header))) {
+        return false;
+    }
+    *type = header[0];
+    *len = get_u32(header + 1);
+    if(*len > XSORT_MAX_FRAME) {
+        fprintf(stderr, "xsort socket: frame of %u bytes is too large\n", *len);
+        return false;
+    }
+    uint8_t *p = realloc(*payload, *len ? *len : 1);
+    if(!p) {
+        perror("realloc");
+        exit(1);
+    }
+    *payload = p;
+    return recv_all(fd, *payload, *len);
+}
+
+static void bridge_ops(int conn, int read_fd, int write_fd, int bufLen) {
+    // translates OPS frames into the pipe protocol spoken with the renderer
+    uint8_t *frame = NULL;
+    uint8_t *results = NULL;
+    int type;
+    uint32_t len;
+    while(recv_frame(conn, &type, &frame, &len)) {
+        if(type != XSORT_FRAME_OPS) {
+            fprintf(stderr, "xsort socket: expected an OPS frame, got type %d\n", type);
+            break;
+        }
+        uint8_t *r = realloc(results, 4 + len);
+        if(!r) {
+            perror("realloc");
+            exit(1);
+        }
+        results = r;
+        uint32_t compares = 0;
+        bool finished = false;
+        bool malformed = false;
+        uint32_t pos = 0;
+        while(pos < len && !finished && !malformed) {
+            uint8_t op = frame[pos++];
+            if(op == XSORT_OP_FINISH) {
+                finished = true;
+                break;
+            }
+            if((op != XSORT_OP_COMPARE && op != XSORT_OP_SWAP) || len - pos < 8) {
+                malformed = true;
+                break;
+            }
+            uint32_t i = get_u32(frame + pos);
+            uint32_t j = get_u32(frame + pos + 4);
+            pos += 8;
+            if(i >= (uint32_t)bufLen || j >= (uint32_t)bufLen) {
+                fprintf(stderr, "xsort socket: index out of range (%u, %u), buffer has %d elements\n", i, j, bufLen);
+                malformed = true;
+                break;
+            }
+            if(op == XSORT_OP_COMPARE) {
+                // exits if the window was closed, which also closes the connection
+                results[4 + compares++] = algo_smaller(read_fd, write_fd, i, j);
+            } else {
+                algo_swap(write_fd, i, j);
+            }
+        }
+        if(malformed) {
+            fprintf(stderr, "xsort socket: malformed OPS frame\n");
+            break;
+        }
+        if(compares > 0) {
+            put_u32(results, compares);
+            if(!send_all(conn, results, 4 + compares)) {
+                break;
+            }
+        }
+        if(finished) {
+            break;
+        }
+    }
+    // also reached when the client disconnects early, so the renderer stops waiting for operations
+    algo_finish(write_fd);
+    free(frame);
+    free(results);
+}
+
+static void serve_connection(int conn) {
+    uint8_t *hello = NULL;
+    int type;
+    uint32_t len;
+    if(!recv_frame(conn, &type, &hello, &len)) {
+        return;
+    }
+    if(type != XSORT_FRAME_HELLO || len < 10) {
+        fprintf(stderr, "xsort socket: expected a HELLO frame\n");
+        return;
+    }
+    uint32_t version = get_u32(hello);
+    uint32_t nameLen = hello[4] | hello[5] << 8;
+    if(version != XSORT_PROTOCOL_VERSION || len < 10 + nameLen) {
+        fprintf(stderr, "xsort socket: unsupported protocol version %u\n", version);
+        return;
+    }
+    char name[256];
+    snprintf(name, sizeof(name), "%.*s", (int)nameLen, (char*)hello + 6);
+    uint32_t count = get_u32(hello + 6 + nameLen);
+    if(count == 0 || count > INT_MAX || len != 10 + nameLen + (uint64_t)count * 8) {
+        fprintf(stderr, "xsort socket: HELLO frame has a bad buffer length\n");
+        return;
+    }
+    int64_t *buf = malloc(count * sizeof(int64_t));
+    if(!buf) {
+        perror("malloc");
+        exit(1);
+    }
+    const uint8_t *values = hello + 10 + nameLen;
+    for(uint32_t i = 0; i < count; i++) {
+        uint64_t v = (uint64_t)get_u32(values + i * 8) | (uint64_t)get_u32(values + i * 8 + 4) << 32;
+        buf[i] = (int64_t)v;
+    }
+    free(hello);
+
+    uint8_t reply[4];
+    put_u32(reply, XSORT_PROTOCOL_VERSION);
+    if(!send_all(conn, reply, sizeof(reply))) {
+        free(buf);
+        return;
+    }
+
+    int renderer_to_bridge[2];
+    int bridge_to_renderer[2];
+    pipe_(renderer_to_bridge);
+    pipe_(bridge_to_renderer);
+    // listen_main ignores SIGCHLD, the renderer reaps the bridge for its rusage
+    signal(SIGCHLD, SIG_DFL);
+    pid_t pid = fork();
+    if(pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0) {
+        close_(renderer_to_bridge[1]);
+        close_(bridge_to_renderer[0]);
+        bridge_ops(conn, renderer_to_bridge[0], bridge_to_renderer[1], count);
+        exit(0);
+    }
+    close_(conn);
+    close_(renderer_to_bridge[0]);
+    close_(bridge_to_renderer[1]);
+    // external clients always send int64 values
+    struct elem_buf eb;
+    elem_buf_wrap(&eb, buf, count);
+    struct renderer *r = renderer_open(false);
+    run_sort_fds(r, &eb, name, (struct sort_goal){ GOAL_FULL, count }, bridge_to_renderer[0], renderer_to_bridge[1], pid, 0, -1);
+    renderer_close(r);
+    free(buf);
+}
+
+int listen_main(int argc, char **argv) {
+    // usage: xsort --listen [PATH]
+    const char *path = argc > 1 ? argv[1] : "xsort.sock";
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path \"%s\" is too long\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    struct stat st;
+    if(lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        // stale socket left behind by a previous server
+        unlink(path);
+    }
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(sock < 0) {
+        perror("socket");
+        return 1;
+    }
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("bind");
+        return 1;
+    }
+    if(listen(sock, 16) != 0) {
+        perror("listen");
+        return 1;
+    }
+    signal(SIGCHLD, SIG_IGN);
+    fprintf(stderr, "Listening on %s\n", path);
+
+    while(1) {
+        int conn = accept(sock, NULL, NULL);
+        if(conn < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            return 1;
+        }
+        // every connection gets its own renderer window
+        pid_t pid = fork();
+        if(pid < 0) {
+            perror("fork");
+            close_(conn);
+            continue;
+        }
+        if(pid == 0) {
+            close_(sock);
+            serve_connection(conn);
+            exit(0);
+        }
+        close_(conn);
+    }
+}
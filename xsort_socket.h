@@ -0,0 +1 @@
+int listen_main(int argc, char **argv);
@@ -8,31 +8,48 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <limits.h>
+#include <math.h>
 
 #include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
 
 #include "utils.h"
 #include "xsort_subproc.h"
+#include "xsort_metrics.h"
+#include "xsort_plugins.h"
+#include "xsort_tuning.h"
+#include "xsort_anim.h"
+#include "xsort_usage.h"
 
-static const int64_t COMPARE_SMALLER = 0, SWAP = 1, FINISH = 2;
+static const int64_t COMPARE_SMALLER = 0, SWAP = 1, FINISH = 2, READ = 3, NOTE = 4, PHASE = 5, COMPARE_EXCHANGE = 6;
+// pairs per COMPARE_EXCHANGE message
+#define STAGE_BATCH 4096
 
-static void swap(int write_fd, int i, int j) {
+// every opcode, index and length on the pipe is a varint, so arrays of up to 124 elements pay a byte per field
+// and nothing limits the index to 32 bits
+static void send_op(int write_fd, int64_t op, int64_t i, int64_t j) {
+    char buf[3 * VARINT_MAX];
+    int len = varint_encode(buf, op);
+    len += varint_encode(buf + len, i);
+    len += varint_encode(buf + len, j);
+    write_(write_fd, buf, len);
+}
+
+static void swap(int write_fd, int64_t i, int64_t j) {
     if(i == j) {
         return;
     }
-    write_int(write_fd, SWAP);
-    write_int(write_fd, i);
-    write_int(write_fd, j);
+    send_op(write_fd, SWAP, i, j);
 }
 
-static int smaller(int read_fd, int write_fd, int i, int j) {
-    write_int(write_fd, COMPARE_SMALLER);
-    write_int(write_fd, i);
-    write_int(write_fd, j);
-    int result = read_int(read_fd);
+static int smaller(int read_fd, int write_fd, int64_t i, int64_t j) {
+    send_op(write_fd, COMPARE_SMALLER, i, j);
+    int result = read_varint(read_fd);
     if(result == -1) {
         // window closed before sort finished, exit early
         exit(0);
@@ -40,11 +57,85 @@ static int smaller(int read_fd, int write_fd, int i, int j) {
     return result;
 }
 
-static void bubble_sort(int r, int w, int len) {
+static int64_t read_value(int read_fd, int write_fd, int64_t i) {
+    // reads a key directly, counted separately from comparisons
+    char buf[2 * VARINT_MAX];
+    int len = varint_encode(buf, READ);
+    len += varint_encode(buf + len, i);
+    write_(write_fd, buf, len);
+    int status = read_varint(read_fd);
+    if(status == -1) {
+        // window closed before sort finished, exit early
+        exit(0);
+    }
+    return read_varint(read_fd);
+}
+
+static void note(int write_fd, const char *text) {
+    // free-form text from the algorithm, e.g. which strategy it picked, shown in the window title
+    int len = i_min(strlen(text), SORT_NOTE_LEN - 1);
+    write_varint(write_fd, NOTE);
+    write_varint(write_fd, len);
+    write_(write_fd, (char*)text, len);
+}
+
+static void phase(int write_fd, int64_t start, int64_t end, const char *text) {
+    // hybrids report which phase they switched to and the inclusive range it works on, the renderer marks it
+    int len = i_min(strlen(text), SORT_NOTE_LEN - 1);
+    send_op(write_fd, PHASE, start, end);
+    write_varint(write_fd, len);
+    write_(write_fd, (char*)text, len);
+}
+
+// a stage of a sorting network: the smaller element of every (i, j) pair ends up at i
+// the pairs have to be disjoint, the renderer does them all at once and there is no reply
+// pairs are buffered and sent in batches of at most STAGE_BATCH, which the renderer animates as one step each
+struct stage {
+    int write_fd;
+    int len;
+    char buf[STAGE_BATCH * 2 * VARINT_MAX];
+    int bytes;
+};
+
+static void stage_flush(struct stage *st) {
+    if(st->len == 0) {
+        return;
+    }
+    char header[3 * VARINT_MAX];
+    int len = varint_encode(header, COMPARE_EXCHANGE);
+    len += varint_encode(header + len, st->len);
+    len += varint_encode(header + len, st->bytes);
+    write_(st->write_fd, header, len);
+    write_(st->write_fd, st->buf, st->bytes);
+    st->len = 0;
+    st->bytes = 0;
+}
+
+static void stage_add(struct stage *st, int64_t i, int64_t j) {
+    st->bytes += varint_encode(st->buf + st->bytes, i);
+    st->bytes += varint_encode(st->buf + st->bytes, j);
+    if(++st->len == STAGE_BATCH) {
+        stage_flush(st);
+    }
+}
+
+int algo_smaller(int read_fd, int write_fd, int64_t i, int64_t j) {
+    return smaller(read_fd, write_fd, i, j);
+}
+
+void algo_swap(int write_fd, int64_t i, int64_t j) {
+    swap(write_fd, i, j);
+}
+
+void algo_finish(int write_fd) {
+    write_varint(write_fd, FINISH);
+}
+
+static void bubble_sort(int r, int w, int64_t len) {
     bool swapped = true;
     while(swapped) {
         swapped = false;
-        for(int x = 0;x < len - 1;x++) {
+        for(int64_t x = 0;x < len - 1;x++) {
             if(smaller(r, w, x + 1, x)) {
                 swap(w, x, x + 1);
                 swapped = true;
@@ -53,9 +144,9 @@ static void bubble_sort(int r, int w, int len) {
     };
 }
 
-static void insert_sort(int r, int w, int len) {
-    for(int x = 1;x < len;x++) {
-        for(int y = x;y > 0;y--) {
+static void insert_sort(int r, int w, int64_t len) {
+    for(int64_t x = 1;x < len;x++) {
+        for(int64_t y = x;y > 0;y--) {
             if(smaller(r, w, y, y - 1)) {
                 swap(w, y, y - 1);
             }
@@ -63,10 +154,10 @@ static void insert_sort(int r, int w, int len) {
     }
 }
 
-static void selection_sort(int r, int w, int len) {
-    for(int x = 0;x < len - 1;x++) {
-        int min = x;
-        for(int y = x + 1;y < len;y++) {
+static void selection_sort(int r, int w, int64_t len) {
+    for(int64_t x = 0;x < len - 1;x++) {
+        int64_t min = x;
+        for(int64_t y = x + 1;y < len;y++) {
             if(smaller(r, w, y, min)) {
                 min = y;
             }
@@ -77,7 +168,146 @@ static void selection_sort(int r, int w, int len) {
     }
 }
 
-static void quick_sort_rec(int r, int w, int start, int end) {
+// diminishing increment sorts: insertion sorts over elements gap apart, with the gap shrinking to 1
+// the sequences are built up to len, smallest gap first
+enum gap_sequence { GAPS_SHELL, GAPS_KNUTH, GAPS_SEDGEWICK, GAPS_CIURA, GAPS_TOKUDA };
+#define GAPS_MAX 96
+
+static int shell_gaps(enum gap_sequence seq, int64_t len, int64_t *gaps) {
+    // Ciura's gaps were found experimentally up to 1750, beyond that they grow by 2.25
+    static const int64_t ciura[] = { 1, 4, 10, 23, 57, 132, 301, 701, 1750 };
+    int count = 0;
+    switch(seq) {
+        case GAPS_SHELL:
+            // len / 2, len / 4, ..., 1
+            for(int64_t gap = len / 2; gap > 0; gap /= 2) {
+                count++;
+            }
+            for(int64_t gap = len / 2, i = count - 1; gap > 0; gap /= 2, i--) {
+                gaps[i] = gap;
+            }
+            return count;
+        case GAPS_KNUTH:
+            // (3^k - 1) / 2: 1, 4, 13, 40, ...
+            for(int64_t gap = 1; gap < len && count < GAPS_MAX; gap = 3 * gap + 1) {
+                gaps[count++] = gap;
+            }
+            return count;
+        case GAPS_SEDGEWICK:
+            // 4^k + 3 * 2^(k-1) + 1 after 1: 1, 8, 23, 77, 281, ...
+            if(len > 1) {
+                gaps[count++] = 1;
+            }
+            for(int k = 1; k < 31; k++) {
+                int64_t gap = ((int64_t)1 << (2 * k)) + 3 * ((int64_t)1 << (k - 1)) + 1;
+                if(gap >= len) {
+                    break;
+                }
+                gaps[count++] = gap;
+            }
+            return count;
+        case GAPS_CIURA:
+            for(int i = 0; i < (int)(sizeof(ciura) / sizeof(ciura[0])) && ciura[i] < len; i++) {
+                gaps[count++] = ciura[i];
+            }
+            if(count == (int)(sizeof(ciura) / sizeof(ciura[0]))) {
+                for(double gap = ciura[count - 1] * 2.25; gap < len && count < GAPS_MAX; gap *= 2.25) {
+                    gaps[count++] = (int64_t)gap;
+                }
+            }
+            return count;
+        case GAPS_TOKUDA: {
+            // ceil((9^k - 4^k) / (5 * 4^(k-1))), which is ceil(x) for x = 2.25 * x + 1: 1, 4, 9, 20, 46, ...
+            double x = 1;
+            for(int64_t gap = 1; gap < len && count < GAPS_MAX; x = 2.25 * x + 1, gap = (int64_t)ceil(x)) {
+                gaps[count++] = gap;
+            }
+            return count;
+        }
+    }
+    return 0;
+}
+
+static void shell_sort(int r, int w, int64_t len, enum gap_sequence seq) {
+    int64_t gaps[GAPS_MAX];
+    int count = shell_gaps(seq, len, gaps);
+    for(int g = count - 1; g >= 0; g--) {
+        int64_t gap = gaps[g];
+        char text[SORT_NOTE_LEN];
+        snprintf(text, sizeof(text), "Insertion sort with gap %" PRId64, gap);
+        phase(w, 0, len - 1, text);
+        for(int64_t x = gap;x < len;x++) {
+            for(int64_t y = x;y >= gap && smaller(r, w, y, y - gap);y -= gap) {
+                swap(w, y, y - gap);
+            }
+        }
+    }
+}
+
+static void shell_sort_shell(int r, int w, int64_t len) {
+    shell_sort(r, w, len, GAPS_SHELL);
+}
+
+static void shell_sort_knuth(int r, int w, int64_t len) {
+    shell_sort(r, w, len, GAPS_KNUTH);
+}
+
+static void shell_sort_sedgewick(int r, int w, int64_t len) {
+    shell_sort(r, w, len, GAPS_SEDGEWICK);
+}
+
+static void shell_sort_ciura(int r, int w, int64_t len) {
+    shell_sort(r, w, len, GAPS_CIURA);
+}
+
+static void shell_sort_tokuda(int r, int w, int64_t len) {
+    shell_sort(r, w, len, GAPS_TOKUDA);
+}
+
+// bubble sort over elements gap apart, the gap shrinks by a constant factor down to 1,
+// then passes with gap 1 continue until one makes no swap
+// with rule11 the gaps 9 and 10 become 11, which avoids the slow tail of the 1.3 sequence
+static void comb_sort(int r, int w, int64_t len, double shrink, bool rule11) {
+    int64_t gap = len;
+    bool swapped = true;
+    while(gap > 1 || swapped) {
+        int64_t next = (int64_t)(gap / shrink);
+        if(rule11 && (next == 9 || next == 10)) {
+            next = 11;
+        }
+        if(next < 1) {
+            next = 1;
+        }
+        if(next != gap && len > 1) {
+            char text[SORT_NOTE_LEN];
+            snprintf(text, sizeof(text), "Comb pass with gap %" PRId64, next);
+            phase(w, 0, len - 1, text);
+        }
+        gap = next;
+        swapped = false;
+        for(int64_t x = 0;x + gap < len;x++) {
+            if(smaller(r, w, x + gap, x)) {
+                swap(w, x, x + gap);
+                swapped = true;
+            }
+        }
+    }
+}
+
+static void comb_sort_13(int r, int w, int64_t len) {
+    comb_sort(r, w, len, 1.3, false);
+}
+
+static void comb_sort_11(int r, int w, int64_t len) {
+    comb_sort(r, w, len, 1.3, true);
+}
+
+static void comb_sort_1247(int r, int w, int64_t len) {
+    // the factor Lacey and Box found best, 1 / (1 - 1 / e^phi)
+    comb_sort(r, w, len, 1.247330950103979, false);
+}
+
+static void quick_sort_rec(int r, int w, int64_t start, int64_t end) {
     if(start >= end) {
         return;
     }
@@ -88,8 +318,8 @@ static void quick_sort_rec(int r, int w, int start, int end) {
         return;
     }
     swap(w, start, start + (end - start) / 2);
-    int i = start + 1;
-    int j = end;
+    int64_t i = start + 1;
+    int64_t j = end;
     while(i <= j) {
         if(smaller(r, w, i, start)) {
             i++;
@@ -106,89 +336,1180 @@ static void quick_sort_rec(int r, int w, int start, int end) {
     quick_sort_rec(r, w, j + 1, end);
 }
 
-static void quick_sort(int r, int w, int len) {
+static void quick_sort(int r, int w, int64_t len) {
     quick_sort_rec(r, w, 0, len - 1);
 }
 
-static void heap_sift_down(int r, int w, int len, int i) {
+static void heap_sift_down(int r, int w, int64_t start, int64_t len, int64_t i) {
     // sift-down operation restores max-heap property when the root may be smaller than its children
+    // the heap occupies [start, start + len), i and its children are relative to start
     while(1) {
-        int child1 = i * 2 + 1;
-        int child2 = i * 2 + 2;
-        int largest = i;
-        if(child1 < len && smaller(r, w, largest, child1)) {
+        int64_t child1 = i * 2 + 1;
+        int64_t child2 = i * 2 + 2;
+        int64_t largest = i;
+        if(child1 < len && smaller(r, w, start + largest, start + child1)) {
             largest = child1;
         }
-        if(child2 < len && smaller(r, w, largest, child2)) {
+        if(child2 < len && smaller(r, w, start + largest, start + child2)) {
             largest = child2;
         }
         if(largest == i) {
             break;
         }
-        swap(w, i, largest);
+        swap(w, start + i, start + largest);
         i = largest;
     }
 }
 
-static void heapify(int r, int w, int len) {
+static void heapify(int r, int w, int64_t start, int64_t len) {
     // build max-heap from the bottom up
     // last non-leaf node is at (len - 2) / 2
-    for(int i = (len - 2) / 2; i >= 0; i--) {
-        heap_sift_down(r, w, len, i);
+    for(int64_t i = (len - 2) / 2; i >= 0; i--) {
+        heap_sift_down(r, w, start, len, i);
     }
 }
 
-static void heap_sort(int r, int w, int len) {
-    heapify(r, w, len);
-    for(int i = len - 1; i > 0; i--) {
+static void heap_sort_range(int r, int w, int64_t start, int64_t len) {
+    heapify(r, w, start, len);
+    for(int64_t i = len - 1; i > 0; i--) {
         // extract largest element, move to end of array, reduce heap size by 1, restore max-heap property
+        swap(w, start, start + i);
+        heap_sift_down(r, w, start, i, 0);
+    }
+}
+
+static void heap_sort(int r, int w, int64_t len) {
+    heap_sort_range(r, w, 0, len);
+}
+
+// hybrids, also used as strategies by Auto
+
+static bool insert_sort_bounded(int r, int w, int64_t start, int64_t end, int64_t budget) {
+    // insertion sort of [start, end] that stops as soon as an element is in place
+    // gives up once more than budget swaps were needed, leaving a permutation of the range
+    for(int64_t x = start + 1; x <= end; x++) {
+        for(int64_t y = x; y > start && smaller(r, w, y, y - 1); y--) {
+            swap(w, y, y - 1);
+            if(--budget < 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void insert_sort_range(int r, int w, int64_t start, int64_t end) {
+    insert_sort_bounded(r, w, start, end, INT64_MAX);
+}
+
+static void median_of_3_to_front(int r, int w, int64_t start, int64_t end) {
+    // orders start, middle, end, then moves the median to start; buf[end] >= pivot acts as a sentinel
+    int64_t mid = start + (end - start) / 2;
+    if(smaller(r, w, mid, start)) {
+        swap(w, mid, start);
+    }
+    if(smaller(r, w, end, mid)) {
+        swap(w, end, mid);
+        if(smaller(r, w, mid, start)) {
+            swap(w, mid, start);
+        }
+    }
+    swap(w, start, mid);
+}
+
+static int64_t median_of_3(int r, int w, int64_t a, int64_t b, int64_t c) {
+    // index of the median, without moving anything
+    if(smaller(r, w, a, b)) {
+        return smaller(r, w, b, c) ? b : smaller(r, w, a, c) ? c : a;
+    }
+    return smaller(r, w, a, c) ? a : smaller(r, w, b, c) ? c : b;
+}
+
+static void choose_pivot(int r, int w, int64_t start, int64_t end) {
+    // moves the pivot to start, sampling tuning.pivotSample elements
+    int64_t mid = start + (end - start) / 2;
+    if(tuning.pivotSample == 1 || end - start < 2) {
+        swap(w, start, mid);
+    } else if(tuning.pivotSample == 3 || end - start < 8) {
+        median_of_3_to_front(r, w, start, end);
+    } else {
+        // Tukey's ninther, the median of three medians of 3
+        int64_t d = (end - start) / 8;
+        int64_t m1 = median_of_3(r, w, start, start + d, start + 2 * d);
+        int64_t m2 = median_of_3(r, w, mid - d, mid, mid + d);
+        int64_t m3 = median_of_3(r, w, end - 2 * d, end - d, end);
+        swap(w, start, median_of_3(r, w, m1, m2, m3));
+    }
+}
+
+static int64_t hoare_partition(int r, int w, int64_t start, int64_t end) {
+    // pivot at start, returns its final position; both scans stop on equal keys, which keeps duplicates balanced
+    // the bound check only matters for pivots without a sentinel at end, like median of medians
+    int64_t i = start + 1;
+    int64_t j = end;
+    while(1) {
+        while(i <= end && smaller(r, w, i, start)) {
+            i++;
+        }
+        while(smaller(r, w, start, j)) {
+            j--;
+        }
+        if(i >= j) {
+            break;
+        }
+        swap(w, i, j);
+        i++;
+        j--;
+    }
+    swap(w, start, j);
+    return j;
+}
+
+static void intro_sort_rec(int r, int w, int64_t start, int64_t end, int depth) {
+    while(end - start + 1 > tuning.insertionCutoff) {
+        if(depth-- == 0) {
+            phase(w, start, end, "Introsort: depth limit hit, heap sort");
+            heap_sort_range(r, w, start, end - start + 1);
+            return;
+        }
+        phase(w, start, end, "Introsort: quicksort partition");
+        choose_pivot(r, w, start, end);
+        int64_t p = hoare_partition(r, w, start, end);
+        // recurse into the smaller side, loop on the larger one
+        if(p - start < end - p) {
+            intro_sort_rec(r, w, start, p - 1, depth);
+            start = p + 1;
+        } else {
+            intro_sort_rec(r, w, p + 1, end, depth);
+            end = p - 1;
+        }
+    }
+    if(start < end) {
+        phase(w, start, end, "Introsort: insertion sort below cutoff");
+    }
+    insert_sort_range(r, w, start, end);
+}
+
+static int log2_floor(int64_t len) {
+    int log = 0;
+    while(len > 1) {
+        len >>= 1;
+        log++;
+    }
+    return log;
+}
+
+static void intro_sort(int r, int w, int64_t len) {
+    intro_sort_rec(r, w, 0, len - 1, 2 * log2_floor(len));
+}
+
+// BlockQuicksort: the comparisons for a block on each side are done first and only the offsets of
+// misplaced elements are remembered, then those are swapped pairwise in one batch
+// the native version in xsort_native.c defaults to 64-element blocks, here they are smaller so the
+// batches are visible on buffers that fit in the window
+
+static int64_t block_partition(int r, int w, int64_t start, int64_t end) {
+    // pivot at start, returns its final position; keys equal to the pivot go right
+    int64_t first = start + 1, last = end + 1;
+    const int block = tuning.blockSize;
+    int offsetsL[TUNING_MAX_BLOCK_SIZE], offsetsR[TUNING_MAX_BLOCK_SIZE];
+    int numL = 0, numR = 0, startL = 0, startR = 0;
+    while(last - first >= 2 * block) {
+        if(numL == 0) {
+            startL = 0;
+            for(int64_t i = 0; i < block; i++) {
+                offsetsL[numL] = i;
+                numL += !smaller(r, w, first + i, start);
+            }
+        }
+        if(numR == 0) {
+            startR = 0;
+            for(int64_t i = 0; i < block; i++) {
+                offsetsR[numR] = i + 1;
+                numR += smaller(r, w, last - 1 - i, start);
+            }
+        }
+        int num = i_min(numL, numR);
+        if(num > 0) {
+            char text[SORT_NOTE_LEN];
+            snprintf(text, sizeof(text), "BlockQuicksort: swapping %d misplaced pairs in a batch", num);
+            phase(w, first, last - 1, text);
+        }
+        for(int64_t k = 0; k < num; k++) {
+            swap(w, first + offsetsL[startL + k], last - offsetsR[startR + k]);
+        }
+        numL -= num;
+        numR -= num;
+        startL += num;
+        startR += num;
+        if(numL == 0) {
+            first += block;
+        }
+        if(numR == 0) {
+            last -= block;
+        }
+    }
+    // the rest, including a block which still has misplaced elements, is done one element at a time
+    if(first < last) {
+        phase(w, first, last - 1, "BlockQuicksort: partitioning the remainder");
+    }
+    while(first < last) {
+        if(smaller(r, w, first, start)) {
+            first++;
+        } else {
+            swap(w, first, --last);
+        }
+    }
+    swap(w, start, first - 1);
+    return first - 1;
+}
+
+static void block_quick_sort_rec(int r, int w, int64_t start, int64_t end, int depth) {
+    while(end - start + 1 > tuning.insertionCutoff) {
+        if(depth-- == 0) {
+            // many keys equal to the pivot all go right, the depth limit keeps that from going quadratic
+            heap_sort_range(r, w, start, end - start + 1);
+            return;
+        }
+        choose_pivot(r, w, start, end);
+        int64_t p = block_partition(r, w, start, end);
+        if(p - start < end - p) {
+            block_quick_sort_rec(r, w, start, p - 1, depth);
+            start = p + 1;
+        } else {
+            block_quick_sort_rec(r, w, p + 1, end, depth);
+            end = p - 1;
+        }
+    }
+    insert_sort_range(r, w, start, end);
+}
+
+static void block_quick_sort(int r, int w, int64_t len) {
+    block_quick_sort_rec(r, w, 0, len - 1, 2 * log2_floor(len));
+}
+
+// Timsort over the swap protocol: there is no scratch buffer, so merges are done in place by
+// rotating blocks, and galloping decides how large a block can be rotated at once
+#define TIM_MIN_MERGE 32
+#define TIM_MIN_GALLOP 7
+
+static void reverse_range(int w, int64_t start, int64_t end) {
+    // reverses [start, end)
+    for(end--; start < end; start++, end--) {
+        swap(w, start, end);
+    }
+}
+
+static void rotate_range(int w, int64_t start, int64_t mid, int64_t end) {
+    // moves [mid, end) in front of [start, mid)
+    if(start == mid || mid == end) {
+        return;
+    }
+    reverse_range(w, start, mid);
+    reverse_range(w, mid, end);
+    reverse_range(w, start, end);
+}
+
+static int64_t gallop_left(int r, int w, int64_t key, int64_t base, int64_t len) {
+    // number of elements in the sorted [base, base + len) smaller than buf[key], found by
+    // exponential search from base, then binary search inside the last step
+    if(len == 0 || !smaller(r, w, base, key)) {
+        return 0;
+    }
+    int64_t last = 0, ofs = 1;
+    while(ofs < len && smaller(r, w, base + ofs, key)) {
+        last = ofs;
+        ofs = ofs * 2 + 1;
+    }
+    ofs = i64_min(ofs, len);
+    last++;
+    while(last < ofs) {
+        int64_t m = last + (ofs - last) / 2;
+        if(smaller(r, w, base + m, key)) {
+            last = m + 1;
+        } else {
+            ofs = m;
+        }
+    }
+    return ofs;
+}
+
+static int64_t gallop_right(int r, int w, int64_t key, int64_t base, int64_t len) {
+    // number of elements in the sorted [base, base + len) not larger than buf[key]
+    if(len == 0 || smaller(r, w, key, base)) {
+        return 0;
+    }
+    int64_t last = 0, ofs = 1;
+    while(ofs < len && !smaller(r, w, key, base + ofs)) {
+        last = ofs;
+        ofs = ofs * 2 + 1;
+    }
+    ofs = i64_min(ofs, len);
+    last++;
+    while(last < ofs) {
+        int64_t m = last + (ofs - last) / 2;
+        if(smaller(r, w, key, base + m)) {
+            ofs = m;
+        } else {
+            last = m + 1;
+        }
+    }
+    return ofs;
+}
+
+static int64_t tim_min_run(int64_t len) {
+    // len / minrun is a power of two or slightly less, which keeps the final merges balanced
+    int odd = 0;
+    while(len >= TIM_MIN_MERGE) {
+        odd |= len & 1;
+        len >>= 1;
+    }
+    return len + odd;
+}
+
+static int64_t tim_count_run(int r, int w, int64_t start, int64_t end) {
+    // length of the run at start, a strictly descending run is reversed so the result is ascending
+    int64_t runEnd = start + 1;
+    if(runEnd == end) {
+        return 1;
+    }
+    if(smaller(r, w, runEnd++, start)) {
+        while(runEnd < end && smaller(r, w, runEnd, runEnd - 1)) {
+            runEnd++;
+        }
+        phase(w, start, runEnd - 1, "Timsort: descending run, reversing");
+        reverse_range(w, start, runEnd);
+    } else {
+        while(runEnd < end && !smaller(r, w, runEnd, runEnd - 1)) {
+            runEnd++;
+        }
+        phase(w, start, runEnd - 1, "Timsort: natural run");
+    }
+    return runEnd - start;
+}
+
+static void binary_insertion_sort(int r, int w, int64_t start, int64_t end, int64_t sorted) {
+    // [start, sorted) is already sorted, the rest is inserted after a binary search
+    for(int64_t i = sorted; i < end; i++) {
+        int64_t left = start, right = i;
+        while(left < right) {
+            int64_t m = left + (right - left) / 2;
+            if(smaller(r, w, i, m)) {
+                right = m;
+            } else {
+                left = m + 1;
+            }
+        }
+        rotate_range(w, left, i, i + 1);
+    }
+}
+
+static void tim_merge(int r, int w, int64_t start, int64_t mid, int64_t end, int *minGallop) {
+    // elements of the first run not larger than the second run's head are already in place,
+    // and so are elements of the second run not smaller than the first run's tail
+    start += gallop_right(r, w, mid, start, mid - start);
+    if(start == mid) {
+        return;
+    }
+    end = mid + gallop_left(r, w, mid - 1, mid, end - mid);
+    if(mid == end) {
+        return;
+    }
+    phase(w, start, end - 1, "Timsort: merge");
+    while(start < mid && mid < end) {
+        // one element at a time until one run wins minGallop times in a row
+        int winsA = 0, winsB = 0;
+        while(start < mid && mid < end && winsA < *minGallop && winsB < *minGallop) {
+            if(smaller(r, w, mid, start)) {
+                rotate_range(w, start, mid, mid + 1);
+                mid++;
+                winsB++;
+                winsA = 0;
+            } else {
+                winsA++;
+                winsB = 0;
+            }
+            start++;
+        }
+        if(start == mid || mid == end) {
+            break;
+        }
+        phase(w, start, end - 1, "Timsort: galloping merge");
+        int64_t countA, countB;
+        do {
+            countA = gallop_right(r, w, mid, start, mid - start);
+            start += countA;
+            if(start == mid) {
+                break;
+            }
+            countB = gallop_left(r, w, start, mid, end - mid);
+            rotate_range(w, start, mid, mid + countB);
+            // buf[start] is not larger than the next element of the second run
+            start += countB + 1;
+            mid += countB;
+            *minGallop = i_max(1, *minGallop - 1);
+        } while(start < mid && mid < end && (countA >= TIM_MIN_GALLOP || countB >= TIM_MIN_GALLOP));
+        // galloping stopped paying off, make it harder to enter again
+        *minGallop += 2;
+        if(start < mid && mid < end) {
+            phase(w, start, end - 1, "Timsort: merge");
+        }
+    }
+}
+
+static void tim_sort(int r, int w, int64_t len) {
+    if(len < 2) {
+        return;
+    }
+    int64_t minRun = tim_min_run(len);
+    int minGallop = TIM_MIN_GALLOP;
+    // pending runs; the merge rules keep run lengths growing at least like Fibonacci numbers down the stack
+    int64_t runBase[64], runLen[64];
+    int runs = 0;
+    for(int64_t start = 0; start < len; ) {
+        int64_t n = tim_count_run(r, w, start, len);
+        if(n < minRun) {
+            int64_t forced = i64_min(minRun, len - start);
+            phase(w, start, start + forced - 1, "Timsort: binary insertion up to minrun");
+            binary_insertion_sort(r, w, start, start + forced, start + n);
+            n = forced;
+        }
+        runBase[runs] = start;
+        runLen[runs] = n;
+        runs++;
+        start += n;
+        while(runs > 1) {
+            int64_t i = runs - 2;
+            bool force = start == len;
+            if(!force && (i == 0 || runLen[i - 1] > runLen[i] + runLen[i + 1]) && (i <= 1 || runLen[i - 2] > runLen[i - 1] + runLen[i])) {
+                if(runLen[i] > runLen[i + 1]) {
+                    break;
+                }
+            } else if(i > 0 && runLen[i - 1] < runLen[i + 1]) {
+                i--;
+            }
+            tim_merge(r, w, runBase[i], runBase[i + 1], runBase[i + 1] + runLen[i + 1], &minGallop);
+            runLen[i] += runLen[i + 1];
+            if(i == runs - 3) {
+                runBase[i + 1] = runBase[i + 2];
+                runLen[i + 1] = runLen[i + 2];
+            }
+            runs--;
+        }
+    }
+}
+
+// partial sorts, they only get as far as the k given in the main window's input field
+
+static void median_of_medians_to_front(int r, int w, int64_t start, int64_t end);
+
+static void select_range(int r, int w, int64_t start, int64_t end, int64_t target) {
+    // introselect: quickselect with median-of-3 pivots, switching to median of medians
+    // once 2 * log2 n partitions did not narrow the range down, which bounds it to O(n)
+    int depth = 2 * log2_floor(end - start + 1);
+    while(end - start + 1 > tuning.insertionCutoff) {
+        if(depth-- > 0) {
+            choose_pivot(r, w, start, end);
+        } else {
+            median_of_medians_to_front(r, w, start, end);
+        }
+        int64_t p = hoare_partition(r, w, start, end);
+        if(p == target) {
+            return;
+        }
+        if(target < p) {
+            end = p - 1;
+        } else {
+            start = p + 1;
+        }
+    }
+    insert_sort_range(r, w, start, end);
+}
+
+static void median_of_medians_to_front(int r, int w, int64_t start, int64_t end) {
+    // groups of 5 are sorted in place and their medians gathered at the front,
+    // then the median of those is selected recursively and moved to start
+    int64_t medians = 0;
+    for(int64_t g = start; g <= end; g += 5) {
+        int64_t groupEnd = i64_min(g + 4, end);
+        insert_sort_range(r, w, g, groupEnd);
+        swap(w, start + medians, g + (groupEnd - g) / 2);
+        medians++;
+    }
+    int64_t mid = start + (medians - 1) / 2;
+    select_range(r, w, start, start + medians - 1, mid);
+    swap(w, start, mid);
+}
+
+static void quick_select(int r, int w, int64_t len, int64_t k) {
+    select_range(r, w, 0, len - 1, k - 1);
+}
+
+static void heap_top_k(int r, int w, int64_t len, int64_t k) {
+    // max-heap of the k smallest seen so far, each later element replaces the root if it is smaller
+    heapify(r, w, 0, k);
+    for(int64_t i = k; i < len; i++) {
+        if(smaller(r, w, i, 0)) {
+            swap(w, i, 0);
+            heap_sift_down(r, w, 0, k, 0);
+        }
+    }
+    for(int64_t i = k - 1; i > 0; i--) {
         swap(w, 0, i);
-        heap_sift_down(r, w, i, 0);
+        heap_sift_down(r, w, 0, i, 0);
+    }
+}
+
+static void partial_quick_sort_rec(int r, int w, int64_t start, int64_t end, int64_t k) {
+    // quicksort that never recurses into a partition lying entirely at or after index k
+    while(start < k && end - start + 1 > tuning.insertionCutoff) {
+        choose_pivot(r, w, start, end);
+        int64_t p = hoare_partition(r, w, start, end);
+        partial_quick_sort_rec(r, w, start, p - 1, k);
+        start = p + 1;
+    }
+    if(start < k) {
+        insert_sort_range(r, w, start, end);
+    }
+}
+
+static void partial_quick_sort(int r, int w, int64_t len, int64_t k) {
+    partial_quick_sort_rec(r, w, 0, len - 1, k);
+}
+
+static void three_way_sort_rec(int r, int w, int64_t start, int64_t end) {
+    // Bentley-McIlroy partition: keys equal to the pivot are parked at both ends during the scan
+    //     [start, p] == pivot, (p, i) < pivot, (j, q) > pivot, [q, end] == pivot
+    // then swapped into the middle, so runs of equal keys are never looked at again
+    while(end - start + 1 > tuning.insertionCutoff) {
+        choose_pivot(r, w, start, end);
+        // the pivot stays at start until the scan is done
+        int64_t i = start, j = end + 1;
+        int64_t p = start, q = end + 1;
+        while(1) {
+            while(smaller(r, w, ++i, start)) {
+                if(i == end) {
+                    break;
+                }
+            }
+            while(smaller(r, w, start, --j)) {
+                if(j == start) {
+                    break;
+                }
+            }
+            if(i == j && !smaller(r, w, i, start) && !smaller(r, w, start, i)) {
+                swap(w, ++p, i);
+            }
+            if(i >= j) {
+                break;
+            }
+            swap(w, i, j);
+            // buf[i] is known to be <= pivot and buf[j] >= pivot, one compare tells if they are equal
+            if(!smaller(r, w, i, start)) {
+                swap(w, ++p, i);
+            }
+            if(!smaller(r, w, start, j)) {
+                swap(w, --q, j);
+            }
+        }
+        i = j + 1;
+        for(int64_t k = start; k <= p; k++) {
+            swap(w, k, j--);
+        }
+        for(int64_t k = end; k >= q; k--) {
+            swap(w, k, i++);
+        }
+        // now [start, j] < pivot, (j, i) == pivot, [i, end] > pivot
+        if(j - start < end - i) {
+            three_way_sort_rec(r, w, start, j);
+            start = i;
+        } else {
+            three_way_sort_rec(r, w, i, end);
+            end = j;
+        }
+    }
+    insert_sort_range(r, w, start, end);
+}
+
+static void three_way_sort(int r, int w, int64_t len) {
+    three_way_sort_rec(r, w, 0, len - 1);
+}
+
+static void swap_keys(int w, int64_t *keys, int64_t i, int64_t j) {
+    // swap that also keeps the local copy of the keys in sync
+    if(i == j) {
+        return;
+    }
+    int64_t tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+    swap(w, i, j);
+}
+
+static int64_t *read_all_keys(int r, int w, int64_t len) {
+    int64_t *keys = malloc(len * sizeof(int64_t));
+    if(!keys) {
+        perror("malloc");
+        exit(1);
+    }
+    for(int64_t i = 0; i < len; i++) {
+        keys[i] = read_value(r, w, i);
+    }
+    return keys;
+}
+
+static void distribute(int w, int64_t *keys, int64_t *next, const int64_t *bucketEnd, int64_t buckets, int64_t (*bucket_of)(int64_t, const void*), const void *arg) {
+    // in-place distribution (American flag sort): every swap moves one element into its final bucket
+    for(int64_t b = 0; b < buckets; b++) {
+        while(next[b] < bucketEnd[b]) {
+            int64_t target = bucket_of(keys[next[b]], arg);
+            if(target == b) {
+                next[b]++;
+            } else {
+                swap_keys(w, keys, next[b], next[target]);
+                next[target]++;
+            }
+        }
+    }
+}
+
+struct radix_arg {
+    uint64_t min;
+    int shift;
+    uint64_t mask;
+};
+
+static int64_t counting_bucket(int64_t key, const void *arg) {
+    return (int64_t)((uint64_t)key - *(const uint64_t*)arg);
+}
+
+static int64_t radix_bucket(int64_t key, const void *arg) {
+    const struct radix_arg *radix = arg;
+    return (int64_t)((((uint64_t)key - radix->min) >> radix->shift) & radix->mask);
+}
+
+static void counting_sort_keys(int w, int64_t *keys, int64_t len, int64_t min, uint64_t range) {
+    // one bucket per value, range is max - min + 1
+    int64_t *next = calloc(range, sizeof(int64_t));
+    int64_t *bucketEnd = calloc(range, sizeof(int64_t));
+    if(!next || !bucketEnd) {
+        perror("calloc");
+        exit(1);
+    }
+    uint64_t umin = (uint64_t)min;
+    for(int64_t i = 0; i < len; i++) {
+        bucketEnd[counting_bucket(keys[i], &umin)]++;
+    }
+    int64_t sum = 0;
+    for(uint64_t b = 0; b < range; b++) {
+        next[b] = sum;
+        sum += bucketEnd[b];
+        bucketEnd[b] = sum;
+    }
+    distribute(w, keys, next, bucketEnd, range, counting_bucket, &umin);
+    free(next);
+    free(bucketEnd);
+}
+
+static void radix_sort_rec(int r, int w, int64_t *keys, int64_t start, int64_t end, uint64_t min, int shift) {
+    // MSD radix sort on tuning.radixBits wide digits of key - min, buckets below the cutoff use insertion sort
+    if(end - start <= tuning.insertionCutoff) {
+        // keep the local keys in sync with the compare-based insertion sort
+        for(int64_t x = start + 1; x < end; x++) {
+            for(int64_t y = x; y > start && smaller(r, w, y, y - 1); y--) {
+                swap_keys(w, keys, y, y - 1);
+            }
+        }
+        return;
+    }
+    int buckets = 1 << tuning.radixBits;
+    int64_t *next = calloc(buckets, sizeof(int64_t));
+    int64_t *bucketEnd = calloc(buckets, sizeof(int64_t));
+    if(!next || !bucketEnd) {
+        perror("calloc");
+        exit(1);
+    }
+    struct radix_arg arg = { min, shift, buckets - 1 };
+    for(int64_t i = start; i < end; i++) {
+        bucketEnd[radix_bucket(keys[i], &arg)]++;
+    }
+    int64_t sum = start;
+    for(int b = 0; b < buckets; b++) {
+        next[b] = sum;
+        sum += bucketEnd[b];
+        bucketEnd[b] = sum;
+    }
+    distribute(w, keys, next, bucketEnd, buckets, radix_bucket, &arg);
+    if(shift > 0) {
+        int64_t bucketStart = start;
+        for(int b = 0; b < buckets; b++) {
+            radix_sort_rec(r, w, keys, bucketStart, bucketEnd[b], min, shift - tuning.radixBits);
+            bucketStart = bucketEnd[b];
+        }
+    }
+    free(next);
+    free(bucketEnd);
+}
+
+#define AUTO_SAMPLES 32
+
+static void auto_sort(int r, int w, int64_t len) {
+    // samples AUTO_SAMPLES adjacent pairs to estimate presortedness, distinct values and range, then picks a strategy
+    if(len < 2) {
+        note(w, "Auto: nothing to sort");
+        return;
+    }
+    int pairs = i64_min(AUTO_SAMPLES, len - 1);
+    int64_t sample[2 * AUTO_SAMPLES];
+    int descents = 0;
+    for(int64_t k = 0; k < pairs; k++) {
+        int64_t p = k * (len - 1) / pairs;
+        sample[2 * k] = read_value(r, w, p);
+        sample[2 * k + 1] = read_value(r, w, p + 1);
+        if(sample[2 * k] > sample[2 * k + 1]) {
+            descents++;
+        }
+    }
+    int samplesLen = 2 * pairs;
+    int64_t min = sample[0], max = sample[0];
+    for(int64_t k = 1; k < samplesLen; k++) {
+        min = sample[k] < min ? sample[k] : min;
+        max = sample[k] > max ? sample[k] : max;
+    }
+    // distinct values in the sample, by insertion sorting a copy
+    int64_t sorted[2 * AUTO_SAMPLES];
+    for(int64_t k = 0; k < samplesLen; k++) {
+        int64_t y = k;
+        while(y > 0 && sorted[y - 1] > sample[k]) {
+            sorted[y] = sorted[y - 1];
+            y--;
+        }
+        sorted[y] = sample[k];
+    }
+    int distinct = 1;
+    for(int64_t k = 1; k < samplesLen; k++) {
+        distinct += sorted[k] != sorted[k - 1];
+    }
+    uint64_t range = (uint64_t)max - (uint64_t)min;
+    char text[SORT_NOTE_LEN];
+
+    if(descents == pairs && distinct > 1) {
+        snprintf(text, sizeof(text), "Auto: reverse + insertion (%d/%d sampled pairs descending)", descents, pairs);
+        note(w, text);
+        for(int64_t i = 0; i < len / 2; i++) {
+            swap(w, i, len - 1 - i);
+        }
+        // the sample can miss ascending stretches, bounded like the sorted case below
+        if(insert_sort_bounded(r, w, 0, len - 1, len)) {
+            return;
+        }
+        // the insertion sort left a sorted prefix, which Timsort takes as its first run
+        snprintf(text, sizeof(text), "Auto: insertion gave up after %" PRId64 " swaps, Timsort", len);
+        note(w, text);
+        tim_sort(r, w, len);
+        return;
+    }
+    if(descents == 0 && range >= (uint64_t)len * 2) {
+        // looks sorted, but a few far-displaced elements missed by the sample make insertion sort quadratic
+        // give up after a linear number of swaps and keep the sorted prefix, so a wrong guess costs at most a constant factor
+        // any sampled descent already means displaced elements, those inputs go to the strategies below,
+        // and so does a small range, where counting sort needs one read per element whatever the order
+        snprintf(text, sizeof(text), "Auto: insertion (%d/%d sampled pairs descending)", descents, pairs);
+        note(w, text);
+        if(insert_sort_bounded(r, w, 0, len - 1, len)) {
+            return;
+        }
+        snprintf(text, sizeof(text), "Auto: insertion gave up after %" PRId64 " swaps, Timsort", len);
+        note(w, text);
+        tim_sort(r, w, len);
+        return;
+    }
+    if(range < (uint64_t)len * 2 || range < (1u << 24)) {
+        // small range: read every key once, then distribute with at most one swap per element
+        int64_t *keys = read_all_keys(r, w, len);
+        int64_t exactMin = keys[0], exactMax = keys[0];
+        for(int64_t i = 1; i < len; i++) {
+            exactMin = keys[i] < exactMin ? keys[i] : exactMin;
+            exactMax = keys[i] > exactMax ? keys[i] : exactMax;
+        }
+        uint64_t exactRange = (uint64_t)exactMax - (uint64_t)exactMin;
+        if(exactRange < (uint64_t)len * 2) {
+            snprintf(text, sizeof(text), "Auto: counting (range %" PRIu64 " < 2n)", exactRange + 1);
+            note(w, text);
+            counting_sort_keys(w, keys, len, exactMin, exactRange + 1);
+        } else {
+            int shift = 0;
+            while(shift + tuning.radixBits < 64 && (exactRange >> (shift + tuning.radixBits)) != 0) {
+                shift += tuning.radixBits;
+            }
+            snprintf(text, sizeof(text), "Auto: radix (range %" PRIu64 ", %d digits of %d bits)", exactRange + 1, shift / tuning.radixBits + 1, tuning.radixBits);
+            note(w, text);
+            radix_sort_rec(r, w, keys, 0, len, (uint64_t)exactMin, shift);
+        }
+        free(keys);
+        return;
+    }
+    if(distinct * 4 <= samplesLen) {
+        snprintf(text, sizeof(text), "Auto: three-way quicksort (%d distinct in %d samples)", distinct, samplesLen);
+        note(w, text);
+        three_way_sort(r, w, len);
+        return;
+    }
+    snprintf(text, sizeof(text), "Auto: introsort (%d/%d descending, %d/%d distinct)", descents, pairs, distinct, samplesLen);
+    note(w, text);
+    intro_sort(r, w, len);
+}
+
+static struct stage *alloc_stage(int write_fd) {
+    struct stage *st = calloc(1, sizeof(struct stage));
+    if(!st) {
+        perror("calloc");
+        exit(1);
+    }
+    st->write_fd = write_fd;
+    return st;
+}
+
+static void bitonic_sort(int r, int w, int64_t len) {
+    (void)r;
+    struct stage *st = alloc_stage(w);
+    int64_t n = 1;
+    while(n < len) {
+        n *= 2;
+    }
+    // the network for the next power of two, comparators that reach past len are left out
+    // because every comparator puts the minimum first, the missing elements act as +infinity at the end
+    for(int64_t k = 2; k <= n; k *= 2) {
+        char text[SORT_NOTE_LEN];
+        snprintf(text, sizeof(text), "Bitonic merge into blocks of %" PRId64, k);
+        phase(w, 0, len - 1, text);
+        // the first stage of a merge compares mirrored positions, so the second half needs no reversal
+        for(int64_t i = 0; i < len; i++) {
+            int64_t partner = i ^ (k - 1);
+            if(i < partner && partner < len) {
+                stage_add(st, i, partner);
+            }
+        }
+        stage_flush(st);
+        for(int64_t j = k / 4; j >= 1; j /= 2) {
+            for(int64_t i = 0; i < len; i++) {
+                int64_t partner = i ^ j;
+                if(i < partner && partner < len) {
+                    stage_add(st, i, partner);
+                }
+            }
+            stage_flush(st);
+        }
     }
+    free(st);
 }
 
-typedef void (*sort_algo)(int, int, int);
-static const sort_algo sort_algos[ALGO_LEN] = {
-    bubble_sort,
-    insert_sort,
-    selection_sort,
-    quick_sort,
-    heap_sort,
-    NULL,
+static void odd_even_merge_sort(int r, int w, int64_t len) {
+    (void)r;
+    struct stage *st = alloc_stage(w);
+    // Batcher's network, merging sorted blocks of p into blocks of 2p with comparators at distance k
+    for(int64_t p = 1; p < len; p *= 2) {
+        char text[SORT_NOTE_LEN];
+        snprintf(text, sizeof(text), "Odd-even merge into blocks of %" PRId64, 2 * p);
+        phase(w, 0, len - 1, text);
+        for(int64_t k = p; k >= 1; k /= 2) {
+            for(int64_t j = k % p; j + k < len; j += 2 * k) {
+                for(int64_t i = 0; i < k && i + j + k < len; i++) {
+                    if((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        stage_add(st, i + j, i + j + k);
+                    }
+                }
+            }
+            stage_flush(st);
+        }
+    }
+    free(st);
+}
+
+typedef void (*sort_algo)(int, int, int64_t);
+typedef void (*partial_sort_algo)(int, int, int64_t, int64_t);
+struct algo {
+    const char *name;
+    sort_algo sort;
+    const struct xsort_plugin *plugin;
+    unsigned flags;
+    // partial sorts take k instead and only reach the given goal
+    partial_sort_algo partial;
+    enum sort_goal_kind goal;
 };
-const char * const algo_names[ALGO_LEN] = {
-    "Bubble Sort",
-    "Insertion Sort",
-    "Selection Sort",
-    "Quick Sort",
-    "Heap Sort",
-    "All",
+static const struct algo builtin_algos[] = {
+    { "Bubble Sort", bubble_sort, NULL, XSORT_CAP_QUADRATIC, NULL, GOAL_FULL },
+    { "Insertion Sort", insert_sort, NULL, XSORT_CAP_QUADRATIC, NULL, GOAL_FULL },
+    { "Selection Sort", selection_sort, NULL, XSORT_CAP_QUADRATIC, NULL, GOAL_FULL },
+    // "All" runs one variant of each, the others differ only in their gaps
+    { "Shell Sort (Shell)", shell_sort_shell, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Shell Sort (Knuth)", shell_sort_knuth, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Shell Sort (Sedgewick)", shell_sort_sedgewick, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Shell Sort (Ciura)", shell_sort_ciura, NULL, 0, NULL, GOAL_FULL },
+    { "Shell Sort (Tokuda)", shell_sort_tokuda, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Comb Sort (1.3)", comb_sort_13, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Comb Sort (Comb11)", comb_sort_11, NULL, 0, NULL, GOAL_FULL },
+    { "Comb Sort (1.247)", comb_sort_1247, NULL, XSORT_CAP_NOT_IN_ALL, NULL, GOAL_FULL },
+    { "Quick Sort", quick_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Heap Sort", heap_sort, NULL, 0, NULL, GOAL_FULL },
+    { "3-Way Quick Sort", three_way_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Introsort", intro_sort, NULL, 0, NULL, GOAL_FULL },
+    { "BlockQuicksort", block_quick_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Timsort", tim_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Bitonic Sort", bitonic_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Odd-Even Merge Sort", odd_even_merge_sort, NULL, 0, NULL, GOAL_FULL },
+    { "Auto", auto_sort, NULL, 0, NULL, GOAL_FULL },
+    // partial sorts end on an unsorted buffer, "All" compares full sorts only
+    { "Quickselect (k-th)", NULL, NULL, XSORT_CAP_NOT_IN_ALL, quick_select, GOAL_NTH },
+    { "Heap Top-k", NULL, NULL, XSORT_CAP_NOT_IN_ALL, heap_top_k, GOAL_PREFIX },
+    { "Partial Quick Sort", NULL, NULL, XSORT_CAP_NOT_IN_ALL, partial_quick_sort, GOAL_PREFIX },
 };
+#define BUILTIN_LEN ((int)(sizeof(builtin_algos) / sizeof(builtin_algos[0])))
+// plugins are appended after the built-in algorithms, "All" is always the last selection
+static struct algo *plugin_algos = NULL;
+static int pluginsLen = 0;
+
+void algo_load_plugins(void) {
+    const char *dir = getenv("XSORT_PLUGIN_DIR");
+    int len;
+    const struct xsort_plugin **plugins = plugins_load(dir ? dir : "plugins", &len);
+    plugin_algos = len ? calloc(len, sizeof(struct algo)) : NULL;
+    if(len && !plugin_algos) {
+        perror("calloc");
+        exit(1);
+    }
+    for(int i = 0; i < len; i++) {
+        plugin_algos[i] = (struct algo){ plugins[i]->name, NULL, plugins[i], plugins[i]->flags, NULL, GOAL_FULL };
+    }
+    pluginsLen = len;
+    free(plugins);
+}
+
+static const struct algo *get_algo(int algoSelection) {
+    assert(algoSelection >= 0 && algoSelection < algo_count() - 1);
+    if(algoSelection < BUILTIN_LEN) {
+        return &builtin_algos[algoSelection];
+    }
+    return &plugin_algos[algoSelection - BUILTIN_LEN];
+}
+
+int algo_find(const char *name) {
+    for(int algo = 0; algo < algo_count() - 1; algo++) {
+        if(strcmp(algo_name(algo), name) == 0) {
+            return algo;
+        }
+    }
+    return -1;
+}
+
+int algo_count(void) {
+    return BUILTIN_LEN + pluginsLen + 1;
+}
+
+const char *algo_name(int algoSelection) {
+    if(algoSelection == algo_count() - 1) {
+        return "All";
+    }
+    return get_algo(algoSelection)->name;
+}
+
+unsigned algo_flags(int algoSelection) {
+    if(algoSelection == algo_count() - 1) {
+        return 0;
+    }
+    return get_algo(algoSelection)->flags;
+}
 
-static bool get_swap_request(int read_fd, int write_fd, int64_t *buf, int len, int *i, int *j, int *comparisions) {
+struct sort_goal algo_goal(int algoSelection, int64_t bufLen, int64_t k) {
+    if(algoSelection == algo_count() - 1 || get_algo(algoSelection)->goal == GOAL_FULL) {
+        return (struct sort_goal){ GOAL_FULL, bufLen };
+    }
+    k = k < 1 ? 1 : k > bufLen ? bufLen : k;
+    return (struct sort_goal){ get_algo(algoSelection)->goal, k };
+}
+
+bool sort_goal_met(const int64_t *buf, int64_t len, struct sort_goal goal) {
+    switch(goal.kind) {
+        case GOAL_FULL:
+            for(int64_t i = 1; i < len; i++) {
+                if(buf[i] < buf[i - 1]) {
+                    return false;
+                }
+            }
+            return true;
+        case GOAL_NTH:
+            // nothing before k - 1 is larger, nothing after it is smaller
+            for(int64_t i = 0; i < len; i++) {
+                if(i < goal.k - 1 ? buf[i] > buf[goal.k - 1] : buf[i] < buf[goal.k - 1]) {
+                    return false;
+                }
+            }
+            return true;
+        case GOAL_PREFIX:
+            // the first k are sorted and nothing after them is smaller
+            for(int64_t i = 1; i < len; i++) {
+                if(i < goal.k ? buf[i] < buf[i - 1] : buf[i] < buf[goal.k - 1]) {
+                    return false;
+                }
+            }
+            return true;
+    }
+    return false;
+}
+
+static int plugin_smaller(void *ctx, int64_t i, int64_t j) {
+    int *fds = ctx;
+    return smaller(fds[0], fds[1], i, j);
+}
+
+static void plugin_swap(void *ctx, int64_t i, int64_t j) {
+    int *fds = ctx;
+    swap(fds[1], i, j);
+}
+
+static void log_op(struct sort_op_log *log, enum sort_op_kind kind, int64_t i, int64_t j) {
+    if(!log) {
+        return;
+    }
+    if(log->len == log->cap) {
+        log->cap = log->cap ? log->cap * 2 : 1024;
+        struct sort_op *ops = reallocarray(log->ops, log->cap, sizeof(struct sort_op));
+        if(!ops) {
+            perror("reallocarray");
+            exit(1);
+        }
+        log->ops = ops;
+    }
+    log->ops[log->len++] = (struct sort_op){ kind, i, j };
+}
+
+static int compare_index(const void *a, const void *b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool pairs_disjoint(const int64_t *pairs, int count) {
+    // the renderer moves all pairs of a stage at once, no element may be in two of them
+    int64_t *sorted = malloc(count * 2 * sizeof(int64_t));
+    if(!sorted) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(sorted, pairs, count * 2 * sizeof(int64_t));
+    qsort(sorted, count * 2, sizeof(int64_t), compare_index);
+    bool disjoint = true;
+    for(int k = 1; k < count * 2; k++) {
+        disjoint &= sorted[k] != sorted[k - 1];
+    }
+    free(sorted);
+    return disjoint;
+}
+
+static int64_t *alloc_swaps(void) {
+    // room for the largest step, a batch of STAGE_BATCH exchanges
+    int64_t *swaps = malloc(STAGE_BATCH * 2 * sizeof(int64_t));
+    if(!swaps) {
+        perror("malloc");
+        exit(1);
+    }
+    return swaps;
+}
+
+static bool get_swap_request(int read_fd, int write_fd, const struct elem_buf *eb, const int64_t *keys, int64_t *swaps, int *swapsLen, struct sort_stats *stats, struct sort_op_log *log) {
+    // the next step as (i, j) pairs in swaps, which has room for a batch (see alloc_swaps)
+    // a step is a single swap, or the exchanges of a compare-exchange batch, which are disjoint
+    // compares go through the element type, reads get the order-preserving int64 key
+    // compares, reads and the returned swaps are appended to log when it is not NULL
+    const int64_t len = eb->len;
     while(1) {
-        int request = read_int(read_fd);
+        int64_t request = read_varint(read_fd);
         if(request == FINISH) {
             return false;
         }
         if(request == SWAP) {
-            *i = read_int(read_fd);
-            *j = read_int(read_fd);
+            swaps[0] = read_varint(read_fd);
+            swaps[1] = read_varint(read_fd);
+            *swapsLen = 1;
+            log_op(log, SORT_OP_SWAP, swaps[0], swaps[1]);
             return true;
         }
+        if(request == COMPARE_EXCHANGE) {
+            int count = read_varint(read_fd);
+            int bytes = read_varint(read_fd);
+            assert(count > 0 && count <= STAGE_BATCH);
+            assert(bytes > 0 && bytes <= count * 2 * VARINT_MAX);
+            char buf[STAGE_BATCH * 2 * VARINT_MAX];
+            read_(read_fd, buf, bytes);
+            const char *p = buf;
+            for(int k = 0; k < count * 2; k++) {
+                p += varint_decode(p, &swaps[k]);
+            }
+            assert(p == buf + bytes);
+            assert(pairs_disjoint(swaps, count));
+            stats->comparisons += count;
+            stats->stages++;
+            int exchanged = 0;
+            for(int k = 0; k < count; k++) {
+                int64_t a = swaps[2 * k], b = swaps[2 * k + 1];
+                assert(a >= 0 && a < len && b >= 0 && b < len && a != b);
+                log_op(log, SORT_OP_COMPARE, b, a);
+                if(elem_smaller(eb, b, a)) {
+                    swaps[2 * exchanged] = a;
+                    swaps[2 * exchanged + 1] = b;
+                    exchanged++;
+                    log_op(log, SORT_OP_SWAP, a, b);
+                }
+            }
+            if(exchanged == 0) {
+                continue;
+            }
+            *swapsLen = exchanged;
+            return true;
+        }
+        if(request == READ) {
+            stats->reads++;
+            int64_t a = read_varint(read_fd);
+            assert(a >= 0 && a < len);
+            log_op(log, SORT_OP_READ, a, a);
+            char buf[2 * VARINT_MAX];
+            int bytes = varint_encode(buf, 0);
+            bytes += varint_encode(buf + bytes, keys[a]);
+            write_(write_fd, buf, bytes);
+            continue;
+        }
+        if(request == PHASE) {
+            stats->phaseStart = read_varint(read_fd);
+            stats->phaseEnd = read_varint(read_fd);
+            assert(stats->phaseStart >= 0 && stats->phaseEnd < len);
+            int phaseLen = read_varint(read_fd);
+            assert(phaseLen >= 0 && phaseLen < SORT_NOTE_LEN);
+            read_(read_fd, stats->phase, phaseLen);
+            stats->phase[phaseLen] = '\0';
+            stats->phases++;
+            continue;
+        }
+        if(request == NOTE) {
+            int noteLen = read_varint(read_fd);
+            assert(noteLen >= 0 && noteLen < SORT_NOTE_LEN);
+            read_(read_fd, stats->note, noteLen);
+            stats->note[noteLen] = '\0';
+            stats->notes++;
+            continue;
+        }
         assert(request == COMPARE_SMALLER);
-        (*comparisions)++;
-        int a = read_int(read_fd);
-        int b = read_int(read_fd);
+        stats->comparisons++;
+        int64_t a = read_varint(read_fd);
+        int64_t b = read_varint(read_fd);
         assert(a >= 0 && a < len);
         assert(b >= 0 && b < len);
-        write_int(write_fd, buf[a] < buf[b]);
+        log_op(log, SORT_OP_COMPARE, a, b);
+        write_varint(write_fd, elem_smaller(eb, a, b));
     }
 }
 
-static void draw_num_sphere(Display *display, Window window, GC gc, XFontStruct *font, int sphereCenterX, int sphereCenterY, int radius, int64_t nr, int baseY) {
-    char str[32];
-    const int len = sprintf(str, "%" PRId64, nr);
+static void draw_num_sphere(Display *display, Window window, GC gc, XFontStruct *font, int sphereCenterX, int sphereCenterY, int radius, const struct elem_buf *eb, int idx, int baseY) {
+    char str[64];
+    const int len = elem_format(eb, idx, str, sizeof(str));
     int numWidth = XTextWidth(font, str, len);
     int numHeight = font->ascent + font->descent;
     int x = sphereCenterX - numWidth / 2;
@@ -202,35 +1523,11 @@ static void erase_num_sphere(Display *display, Window window, GC gc, int sphereC
     XFillArc(display, window, gc, sphereCenterX - radius, baseY + sphereCenterY - radius, 2 * radius, 2 * radius, 0, 360 * 64);
 }
 
-static time_t get_time_usec(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
-}
-
-struct animation_state {
-    int x, y;
-    int startX, startY;
-    int targetX, targetY;
-    int progress;
-    int end;
-    int sphereIdx1;
-    int sphereIdx2;
-    enum { INIT, DOWN_1, RIGHT_1, UP_2, UP_1, LEFT_2, DOWN_2 } state;
-};
-
-static void update_anim_position(struct animation_state *anim) {
-    assert(anim->progress <= anim->end);
-    double percent = (double)anim->progress / anim->end;
-    double x = anim->startX + (anim->targetX - anim->startX) * percent;
-    double y = anim->startY + (anim->targetY - anim->startY) * percent;
-    anim->x = (int)x;
-    anim->y = (int)y;
-}
+// how often the status pane samples /proc while the algorithm runs
+#define USAGE_INTERVAL_USEC 500000
 
-static void launch_sorting_algorithm(int algoSelection, int bufLen, int *read_fd, int *write_fd) {
-    assert(algoSelection >= 0 && algoSelection < ALGO_LEN - 1);
-    sort_algo sort = sort_algos[algoSelection];
+static pid_t launch_sorting_algorithm(int algoSelection, int64_t bufLen, struct sort_goal goal, int *read_fd, int *write_fd) {
+    const struct algo *algo = get_algo(algoSelection);
 
     int parent_to_child[2];
     int child_to_parent[2];
@@ -246,67 +1543,225 @@ static void launch_sorting_algorithm(int algoSelection, int bufLen, int *read_fd
         *write_fd = parent_to_child[1];
         close_(parent_to_child[0]);
         close_(child_to_parent[1]);
-        return;
+        return pid;
     }
     close_(parent_to_child[1]);
     close_(child_to_parent[0]);
-    sort(parent_to_child[0], child_to_parent[1], bufLen);
-    write_int(child_to_parent[1], FINISH);
+    if(algo->plugin) {
+        int fds[2] = { parent_to_child[0], child_to_parent[1] };
+        struct xsort_plugin_api api = { plugin_smaller, plugin_swap, fds };
+        algo->plugin->sort(&api, bufLen);
+    } else if(algo->partial) {
+        algo->partial(parent_to_child[0], child_to_parent[1], bufLen, goal.k);
+    } else {
+        algo->sort(parent_to_child[0], child_to_parent[1], bufLen);
+    }
+    write_varint(child_to_parent[1], FINISH);
     close_(parent_to_child[0]);
     close_(child_to_parent[1]);
     exit(0);
 }
 
-static void verify_sort(int64_t *buf, int bufLen, const char *algoName) {
-    for(int i = 1; i < bufLen; i++) {
-        if(buf[i - 1] > buf[i]) {
-            fprintf(stderr, "%s: sort bug!\n", algoName);
-            return;
-        }
+static void verify_sort(const struct sort_metrics *metrics, struct sort_goal goal, const char *algoName) {
+    // full sorts use the incrementally maintained metrics, partial goals need an O(n) scan
+    if(goal.kind == GOAL_FULL ? !metrics_sorted(metrics) : !sort_goal_met(metrics->buf, metrics->len, goal)) {
+        fprintf(stderr, "%s: sort bug!\n", algoName);
+        return;
     }
     fprintf(stderr, "%s: sort completed successfully\n", algoName);
 }
 
-int64_t get_anim_nr(struct animation_state *anim, int64_t *buf) {
-    bool is_sphere_1 = anim->state == DOWN_1 || anim->state == RIGHT_1 || anim->state == UP_1;
-    return buf[is_sphere_1 ? anim->sphereIdx1 : anim->sphereIdx2];
+void run_sort_headless_elems(struct elem_buf *eb, int algoSelection, int64_t k, struct sort_stats *stats, struct sort_op_log *log) {
+    // same protocol as run_sort, but swaps are applied immediately instead of being animated
+    int algorithm_read_fd, algorithm_write_fd;
+    pid_t pid = launch_sorting_algorithm(algoSelection, eb->len, algo_goal(algoSelection, eb->len, k), &algorithm_read_fd, &algorithm_write_fd);
+    *stats = (struct sort_stats){0};
+    int64_t *keys = malloc((eb->len ? eb->len : 1) * sizeof(int64_t));
+    if(!keys) {
+        perror("malloc");
+        exit(1);
+    }
+    elem_keys(eb, keys);
+    int64_t *swaps = alloc_swaps();
+    int swapsLen;
+    while(get_swap_request(algorithm_read_fd, algorithm_write_fd, eb, keys, swaps, &swapsLen, stats, log)) {
+        for(int s = 0; s < swapsLen; s++) {
+            int64_t i = swaps[2 * s], j = swaps[2 * s + 1];
+            elem_swap(eb, i, j);
+            int64_t tmp = keys[i];
+            keys[i] = keys[j];
+            keys[j] = tmp;
+            stats->swaps++;
+        }
+    }
+    elem_settle(eb);
+    free(swaps);
+    free(keys);
+    close_(algorithm_read_fd);
+    close_(algorithm_write_fd);
+    while(waitpid(pid, NULL, 0) < 0) {
+        if(errno == EINTR) continue;
+        // ECHILD if SIGCHLD is ignored, the child was reaped automatically
+        break;
+    }
+}
+
+void run_sort_headless(int64_t *buf, int64_t bufLen, int algoSelection, int64_t k, struct sort_stats *stats) {
+    struct elem_buf eb;
+    elem_buf_wrap(&eb, buf, bufLen);
+    run_sort_headless_elems(&eb, algoSelection, k, stats, NULL);
 }
 
-void run_sort(int64_t *buf, int bufLen, int algoSelection) {
-    int algorithm_read_fd, algorithm_write_fd;
-    launch_sorting_algorithm(algoSelection, bufLen, &algorithm_read_fd, &algorithm_write_fd);
+int64_t *sort_op_log_swaps(const struct sort_op_log *log) {
+    int64_t *swaps = malloc((log->len ? log->len : 1) * 2 * sizeof(int64_t));
+    if(!swaps) {
+        perror("malloc");
+        exit(1);
+    }
+    int64_t swapsLen = 0;
+    for(int64_t op = 0; op < log->len; op++) {
+        if(log->ops[op].kind == SORT_OP_SWAP) {
+            swaps[2 * swapsLen] = log->ops[op].i;
+            swaps[2 * swapsLen + 1] = log->ops[op].j;
+            swapsLen++;
+        }
+    }
+    return swaps;
+}
+
+int64_t *run_sort_record(int64_t *buf, int64_t bufLen, int algoSelection, int64_t k, struct sort_stats *stats) {
+    struct elem_buf eb;
+    elem_buf_wrap(&eb, buf, bufLen);
+    struct sort_op_log log = {0};
+    run_sort_headless_elems(&eb, algoSelection, k, stats, &log);
+    int64_t *swaps = sort_op_log_swaps(&log);
+    free(log.ops);
+    return swaps;
+}
 
-    Display *display = XOpenDisplay(NULL);
-    if(!display) {
+struct renderer {
+    Display *display;
+    XFontStruct *font;
+    GC gc, erase_gc;
+    Atom WM_DELETE_WINDOW;
+    unsigned long blackColor, whiteColor;
+    bool prewarmed;
+};
+
+struct renderer *renderer_open(bool prewarmed) {
+    struct renderer *r = malloc(sizeof(struct renderer));
+    if(!r) {
+        perror("malloc");
+        exit(1);
+    }
+    r->prewarmed = prewarmed;
+    r->display = XOpenDisplay(NULL);
+    if(!r->display) {
         fprintf(stderr, "Failed to open display\n");
         exit(1);
     }
-    int blackColor = BlackPixel(display, DefaultScreen(display));
-    int whiteColor = WhitePixel(display, DefaultScreen(display));
+    r->blackColor = BlackPixel(r->display, DefaultScreen(r->display));
+    r->whiteColor = WhitePixel(r->display, DefaultScreen(r->display));
 
     const char *fontQuery = "fixed";
-    XFontStruct *font = XLoadQueryFont(display, fontQuery);
-    if (!font) {
+    r->font = XLoadQueryFont(r->display, fontQuery);
+    if (!r->font) {
         fprintf(stderr, "Failed to load font \"%s\"\n", fontQuery);
         exit(1);
     }
+    // the root window has the default depth, so the GCs work on the sort window and its pixmap
+    r->gc = XCreateGC(r->display, DefaultRootWindow(r->display), 0, NULL);
+    r->erase_gc = XCreateGC(r->display, DefaultRootWindow(r->display), 0, NULL);
+    if(!r->gc || !r->erase_gc) {
+        fprintf(stderr, "Failed to create graphics context\n");
+        exit(1);
+    }
+    XSetForeground(r->display, r->gc, r->blackColor);
+    XSetFont(r->display, r->gc, r->font->fid);
+    XSetForeground(r->display, r->erase_gc, r->whiteColor);
+    r->WM_DELETE_WINDOW = XInternAtom(r->display, "WM_DELETE_WINDOW", False);
+    // wait for the server, so a prewarmed renderer has nothing left to round-trip when the job arrives
+    XSync(r->display, False);
+    return r;
+}
+
+void renderer_close(struct renderer *r) {
+    XFreeGC(r->display, r->gc);
+    XFreeGC(r->display, r->erase_gc);
+    XFreeFont(r->display, r->font);
+    XCloseDisplay(r->display);
+    free(r);
+}
+
+void run_sort(struct renderer *r, int64_t *buf, int64_t bufLen, int algoSelection, int64_t k, int elemType, time_t launchUsec, int status_fd) {
+    int algorithm_read_fd, algorithm_write_fd;
+    struct sort_goal goal = algo_goal(algoSelection, bufLen, k);
+    struct elem_buf eb;
+    elem_buf_init(&eb, elemType, buf, bufLen);
+    // the main window ignores SIGCHLD, the renderer has to reap the algorithm itself to get its rusage
+    signal(SIGCHLD, SIG_DFL);
+    pid_t pid = launch_sorting_algorithm(algoSelection, bufLen, goal, &algorithm_read_fd, &algorithm_write_fd);
+    run_sort_fds(r, &eb, algo_name(algoSelection), goal, algorithm_read_fd, algorithm_write_fd, pid, launchUsec, status_fd);
+    elem_buf_free(&eb);
+}
+
+static void report_usage(struct run_usage *usage, pid_t algorithm_pid, int status_fd) {
+    // called once the algorithm has exited or was told to
+    usage_wait(algorithm_pid, &usage->algorithm);
+    usage_self(&usage->renderer);
+    usage->ipcBytes = ipc_bytes_read + ipc_bytes_written;
+    char str[256];
+    run_usage_format(usage, str, sizeof(str));
+    fprintf(stderr, "%s: %s\n", usage->algoName, str);
+    if(status_fd >= 0) {
+        // smaller than PIPE_BUF, so reports of concurrent renderers do not interleave
+        write_(status_fd, (char*)usage, sizeof(*usage));
+    }
+}
+
+void run_sort_fds(struct renderer *r, struct elem_buf *eb, const char *algoName, struct sort_goal goal, int algorithm_read_fd, int algorithm_write_fd, pid_t algorithm_pid, time_t launchUsec, int status_fd) {
+    if(eb->len > INT_MAX) {
+        // every element is a sphere in one pixmap, far beyond this is only sortable headless
+        fprintf(stderr, "%s: %" PRId64 " elements are too many to animate, use --bench or --external\n", algoName, eb->len);
+        exit(1);
+    }
+    const int bufLen = eb->len;
+    // bytes read and written before belong to whoever forked this process
+    ipc_bytes_read = ipc_bytes_written = 0;
+    struct run_usage usage = {0};
+    snprintf(usage.algoName, sizeof(usage.algoName), "%s", algoName);
+    time_t lastUsage = 0;
+    Display *display = r->display;
+    XFontStruct *font = r->font;
+    GC gc = r->gc;
+    GC erase_gc = r->erase_gc;
+    Atom WM_DELETE_WINDOW = r->WM_DELETE_WINDOW;
 
     int maxWidth = 0;
     for(int i = 0; i < bufLen; i++) {
-        char str[32];
-        const int len = sprintf(str, "%" PRId64, buf[i]);
+        char str[64];
+        const int len = elem_format(eb, i, str, sizeof(str));
         maxWidth = i_max(maxWidth, XTextWidth(font, str, len));
     }
     int radius = maxWidth / 2 + 5;
 
     int viewportHeight = (radius * 2 + 10) * 3;
-    int statusPaneHeight = font->ascent + font->descent + 10;
+    // four lines: operation counts, sortedness metrics, resource usage, then the current phase of hybrid algorithms
+    int statusPaneHeight = (font->ascent + font->descent + 5) * 4 + 5;
     int windowHeight = viewportHeight + statusPaneHeight;
     int windowWidth = i_max(800, 10 * (radius * 2 + 10) + 10);
 
-    Window window = XCreateSimpleWindow(display, DefaultRootWindow(display), 0, 0, windowWidth, windowHeight, 0, blackColor, whiteColor);
-    char titleBuf[128];
-    snprintf(titleBuf, sizeof(titleBuf), "XSort - sorting %d numbers with %s", bufLen, algo_names[algoSelection]);
+    Window window = XCreateSimpleWindow(display, DefaultRootWindow(display), 0, 0, windowWidth, windowHeight, 0, r->blackColor, r->whiteColor);
+    char titleBuf[64 + SORT_NOTE_LEN];
+    char what[32] = "numbers";
+    if(eb->type->kind != ELEM_INT64) {
+        snprintf(what, sizeof(what), "%s elements", eb->type->name);
+    }
+    if(goal.kind == GOAL_FULL) {
+        snprintf(titleBuf, sizeof(titleBuf), "XSort - sorting %d %s with %s", bufLen, what, algoName);
+    } else {
+        snprintf(titleBuf, sizeof(titleBuf), "XSort - partially sorting %d %s (k = %" PRId64 ") with %s", bufLen, what, goal.k, algoName);
+    }
     XClassHint *classHint = XAllocClassHint();
     if(classHint) {
         classHint->res_name = get_instance_name();
@@ -317,17 +1772,6 @@ void run_sort(int64_t *buf, int bufLen, int algoSelection) {
         fprintf(stderr, "XAllocClassHint failed\n");
     }
     XStoreName(display, window, titleBuf);
-    XSelectInput(display, window, StructureNotifyMask);
-    GC gc = XCreateGC(display, window, 0, NULL);
-    GC erase_gc = XCreateGC(display, window, 0, NULL);
-    if(!gc || !erase_gc) {
-        fprintf(stderr, "Failed to create graphics context\n");
-        exit(1);
-    }
-    XSetForeground(display, gc, blackColor);
-    XSetFont(display, gc, font->fid);
-    XSetForeground(display, erase_gc, whiteColor);
-    Atom WM_DELETE_WINDOW = XInternAtom(display, "WM_DELETE_WINDOW", False);
     XSetWMProtocols(display, window, &WM_DELETE_WINDOW, 1);
     XSelectInput(display, window, ExposureMask | KeyPressMask | StructureNotifyMask);
     XMapWindow(display, window);
@@ -342,10 +1786,10 @@ void run_sort(int64_t *buf, int bufLen, int algoSelection) {
     int viewportY = 0;
     XFillRectangle(display, pixmap, erase_gc, 0, 0, fullWidth, viewportHeight * 4);
 
-#define SPHERE_X(i) ((radius * 2 + 10) * (i) + radius + 5)
+#define SPHERE_X(i) sphere_x(radius, i)
 
     for(int i = 0; i < bufLen; i++) {
-        draw_num_sphere(display, pixmap, gc, font, SPHERE_X(i), viewportHeight / 2, radius, buf[i], baseY);
+        draw_num_sphere(display, pixmap, gc, font, SPHERE_X(i), viewportHeight / 2, radius, eb, i, baseY);
     }
 
     time_t frameDuration = 1000000 / 60;
@@ -353,106 +1797,113 @@ void run_sort(int64_t *buf, int bufLen, int algoSelection) {
     int speed = 20;
     int vertical_anim_duration = 10 * speed;
     int horizontal_anim_duration = 20 * speed;
-    struct animation_state anim = { .progress = 1, .end = 0, .state = DOWN_2, .sphereIdx1 = -1, .sphereIdx2 = -1 };
+    // a step is one swap, or every exchange of a network stage, animated side by side in lockstep
+    int64_t *swaps = alloc_swaps();
+    struct animation_state *anims = malloc(STAGE_BATCH * sizeof(struct animation_state));
+    if(!anims) {
+        perror("malloc");
+        exit(1);
+    }
+    anims[0] = (struct animation_state){ .progress = 1, .end = 0, .state = DOWN_2, .sphereIdx1 = -1, .sphereIdx2 = -1 };
+    int animsLen = 1;
     bool animation_running = true;
     int focusX = SPHERE_X(0);
-    int comparisions = 0;
-    int swaps = 0;
+    struct sort_stats stats = {0};
+    int titleNotes = 0;
+    // the metrics work on the int64 keys, metrics_swap keeps them in step with the elements
+    int64_t *keys = malloc((bufLen ? bufLen : 1) * sizeof(int64_t));
+    if(!keys) {
+        perror("malloc");
+        exit(1);
+    }
+    elem_keys(eb, keys);
+    struct sort_metrics metrics;
+    metrics_init(&metrics, keys, bufLen);
+    // launch latency is measured up to the first frame drawn after the server exposed the window
+    bool firstFrame = launchUsec != 0;
+    bool exposed = false;
 
     for(;;) {
         bool changed = false;
         time_t time_since_anim = get_time_usec() - last_time;
         if(animation_running && (time_since_anim >= frameDuration)) {
-            if(anim.progress >= anim.end + 1) {
+            if(anims[0].progress >= anims[0].end + 1) {
                 // animation is done, go to next phase or get next swap request
-                if(anim.sphereIdx1 != -1) {
-                    erase_num_sphere(display, pixmap, erase_gc, anim.x, anim.y, radius, baseY);
-                    draw_num_sphere(display, pixmap, gc, font, anim.targetX, anim.targetY, radius, get_anim_nr(&anim, buf), baseY);
-                    anim.x = anim.targetX;
-                    anim.y = anim.targetY;
+                for(int a = 0; a < animsLen; a++) {
+                    struct animation_state *anim = &anims[a];
+                    if(anim->sphereIdx1 != -1) {
+                        erase_num_sphere(display, pixmap, erase_gc, anim->x, anim->y, radius, baseY);
+                    }
                 }
-                if(anim.state == DOWN_2) {
-                    if(anim.sphereIdx1 != -1) {
-                        swaps++;
-                        int64_t tmp_i = buf[anim.sphereIdx1];
-                        buf[anim.sphereIdx1] = buf[anim.sphereIdx2];
-                        buf[anim.sphereIdx2] = tmp_i;
+                for(int a = 0; a < animsLen; a++) {
+                    struct animation_state *anim = &anims[a];
+                    if(anim->sphereIdx1 != -1) {
+                        draw_num_sphere(display, pixmap, gc, font, anim->targetX, anim->targetY, radius, eb, get_anim_idx(anim), baseY);
+                        anim->x = anim->targetX;
+                        anim->y = anim->targetY;
+                    }
+                }
+                if(anims[0].state == DOWN_2) {
+                    for(int a = 0; a < animsLen; a++) {
+                        if(anims[a].sphereIdx1 != -1) {
+                            stats.swaps++;
+                            elem_swap(eb, anims[a].sphereIdx1, anims[a].sphereIdx2);
+                            metrics_swap(&metrics, anims[a].sphereIdx1, anims[a].sphereIdx2);
+                        }
                     }
 
-                    int nextSphere1, nextSphere2;
-                    if(!get_swap_request(algorithm_read_fd, algorithm_write_fd, buf, bufLen, &nextSphere1, &nextSphere2, &comparisions)) {
+                    if(!get_swap_request(algorithm_read_fd, algorithm_write_fd, eb, keys, swaps, &animsLen, &stats, NULL)) {
                         animation_running = false;
+                        animsLen = 0;
                         close_(algorithm_read_fd);
                         close_(algorithm_write_fd);
-                        verify_sort(buf, bufLen, algo_names[algoSelection]);
+                        elem_settle(eb);
+                        verify_sort(&metrics, goal, algoName);
+                        report_usage(&usage, algorithm_pid, status_fd);
                         continue;
                     }
-                    anim = (struct animation_state){.sphereIdx1 = nextSphere1, .sphereIdx2 = nextSphere2, .state = INIT};
+                    if(stats.notes != titleNotes) {
+                        // the algorithm explained what it is doing, e.g. which strategy Auto picked
+                        titleNotes = stats.notes;
+                        snprintf(titleBuf, sizeof(titleBuf), "XSort - sorting %d %s with %s", bufLen, what, stats.note);
+                        XStoreName(display, window, titleBuf);
+                    }
+                    for(int a = 0; a < animsLen; a++) {
+                        anims[a] = (struct animation_state){.sphereIdx1 = swaps[2 * a], .sphereIdx2 = swaps[2 * a + 1], .state = INIT};
+                    }
                 }
 
-                switch(anim.state) {
-                    case INIT:
-                        // move sphere 1 down
-                        anim.x = anim.startX = SPHERE_X(anim.sphereIdx1);
-                        anim.y = anim.startY = viewportHeight / 2;
-                        anim.targetX = anim.x;
-                        anim.targetY = anim.y + radius * 2 + 10;
-                        anim.end = vertical_anim_duration;
-                        anim.state = DOWN_1;
-                        break;
-                    case DOWN_1:
-                        // move sphere 1 right
-                        anim.startY = anim.y;
-                        anim.targetX = SPHERE_X(anim.sphereIdx2);
-                        anim.end = horizontal_anim_duration;
-                        anim.state = RIGHT_1;
-                        break;
-                    case RIGHT_1:
-                        // move sphere 2 up to not overlap with sphere 1
-                        anim.startX = anim.x;
-                        anim.y = anim.startY = viewportHeight / 2;
-                        anim.targetY = anim.y - radius * 2 - 10;
-                        anim.end = vertical_anim_duration;
-                        anim.state = UP_2;
-                        break;
-                    case UP_2:
-                        // move sphere 1 up
-                        anim.y = anim.startY = viewportHeight / 2 + radius * 2 + 10;
-                        anim.targetY = viewportHeight / 2;
-                        anim.end = vertical_anim_duration;
-                        anim.state = UP_1;
-                        break;
-                    case UP_1:
-                        // move sphere 2 left
-                        anim.startX = anim.x;
-                        anim.startY = anim.y = viewportHeight / 2 - radius * 2 - 10;
-                        anim.targetX = SPHERE_X(anim.sphereIdx1);
-                        anim.targetY = anim.y;
-                        anim.end = horizontal_anim_duration;
-                        anim.state = LEFT_2;
-                        break;
-                    case LEFT_2:
-                        // move sphere 2 down
-                        anim.startX = anim.x;
-                        anim.startY = anim.y;
-                        anim.targetY = viewportHeight / 2;
-                        anim.end = vertical_anim_duration;
-                        anim.state = DOWN_2;
-                        break;
-                    case DOWN_2:
-                        assert(0 && "should not happen");
+                // the swaps of a step move in lockstep, so they all take as long as the longest one
+                int distance = 0;
+                for(int a = 0; a < animsLen; a++) {
+                    distance = i_max(distance, abs(anims[a].sphereIdx2 - anims[a].sphereIdx1));
+                }
+                int horizontalDuration = anim_horizontal_duration(horizontal_anim_duration, distance);
+                for(int a = 0; a < animsLen; a++) {
+                    anim_next_phase(&anims[a], radius, viewportHeight, vertical_anim_duration, horizontalDuration);
                 }
-                anim.progress = 0;
             }
 
-            erase_num_sphere(display, pixmap, erase_gc, anim.x, anim.y, radius, baseY);
-            update_anim_position(&anim);
-            focusX = (int)((double)focusX + ((double)anim.x - focusX) / 10);
-            draw_num_sphere(display, pixmap, gc, font, anim.x, anim.y, radius, get_anim_nr(&anim, buf), baseY);
-            anim.progress += speed;
+            // erase every moving sphere before drawing any, spheres of a stage may pass over each other
+            for(int a = 0; a < animsLen; a++) {
+                erase_num_sphere(display, pixmap, erase_gc, anims[a].x, anims[a].y, radius, baseY);
+            }
+            for(int a = 0; a < animsLen; a++) {
+                update_anim_position(&anims[a]);
+                draw_num_sphere(display, pixmap, gc, font, anims[a].x, anims[a].y, radius, eb, get_anim_idx(&anims[a]), baseY);
+                anims[a].progress += speed;
+            }
+            focusX = anim_follow(focusX, anims[0].x, windowWidth);
 
             last_time = get_time_usec();
             changed = true;
+            if(last_time - lastUsage >= USAGE_INTERVAL_USEC) {
+                // the final numbers come from wait4 once the algorithm has exited
+                lastUsage = last_time;
+                usage_self(&usage.renderer);
+                usage_proc(algorithm_pid, &usage.algorithm);
+                usage.ipcBytes = ipc_bytes_read + ipc_bytes_written;
+            }
         }
 
         bool pending = XPending(display) > 0;
@@ -468,6 +1919,7 @@ void run_sort(int64_t *buf, int bufLen, int algoSelection) {
         // while the animation is running, never block on XNextEvent
         if(pending || !animation_running) {
             XNextEvent(display, &e);
+            exposed |= e.type == Expose;
         } else {
             assert(changed);
             e.type = Expose;
@@ -504,25 +1956,71 @@ void run_sort(int64_t *buf, int bufLen, int algoSelection) {
         if(changed || e.type == Expose) {
             XClearWindow(display, window);
             XCopyArea(display, pixmap, window, gc, focusX - windowWidth / 2, baseY, windowWidth, viewportHeight, 0, viewportY);
-            char statusBuf[256];
-            snprintf(statusBuf, sizeof(statusBuf), "%s: %d comparisons, %d swaps. Speed: %d (change by pressing +/-)", algo_names[algoSelection], comparisions, swaps, speed);
-            int statusX = (windowWidth - XTextWidth(font, statusBuf, strlen(statusBuf))) / 2;
-            if(statusX < 0) {
-                statusX = 0;
+            if(stats.phases) {
+                // bracket under the range the current phase works on
+                int x1 = SPHERE_X(stats.phaseStart) - radius - (focusX - windowWidth / 2);
+                int x2 = SPHERE_X(stats.phaseEnd) + radius - (focusX - windowWidth / 2);
+                int y = viewportY + viewportHeight - 3;
+                XDrawLine(display, window, gc, x1, y, x2, y);
+                XDrawLine(display, window, gc, x1, y, x1, y - 6);
+                XDrawLine(display, window, gc, x2, y, x2, y - 6);
+            }
+            char statusBuf[4][256];
+            char readsBuf[32] = "";
+            if(stats.reads) {
+                snprintf(readsBuf, sizeof(readsBuf), ", %" PRId64 " reads", stats.reads);
+            }
+            char movedBuf[64] = "";
+            if(eb->type->kind != ELEM_INT64) {
+                // swap cost grows with the element size, unless the type is sorted through an index
+                snprintf(movedBuf, sizeof(movedBuf), ", %" PRIu64 " bytes moved (%s, %zu bytes%s)", eb->bytesMoved, eb->type->name, eb->type->size, eb->index ? ", by index" : "");
+            }
+            char stagesBuf[32] = "";
+            if(stats.stages) {
+                // each stage was animated as one step
+                snprintf(stagesBuf, sizeof(stagesBuf), " in %" PRId64 " parallel stages", stats.stages);
+            }
+            snprintf(statusBuf[0], sizeof(statusBuf[0]), "%s: %" PRId64 " comparisons, %" PRId64 " swaps%s%s%s. Speed: %d (change by pressing +/-)", algoName, stats.comparisons, stats.swaps, stagesBuf, readsBuf, movedBuf, speed);
+            double removedPerSwap = stats.swaps == 0 ? 0 : (double)(metrics.initialInversions - metrics.inversions) / stats.swaps;
+            snprintf(statusBuf[1], sizeof(statusBuf[1]), "%" PRId64 " inversions (%.2f removed per swap), %d runs, sorted prefix %d, sorted suffix %d",
+                metrics.inversions, removedPerSwap, metrics_runs(&metrics), metrics_sorted_prefix(&metrics), metrics_sorted_suffix(&metrics));
+            run_usage_format(&usage, statusBuf[2], sizeof(statusBuf[2]));
+            int lines = 3;
+            if(stats.phases) {
+                snprintf(statusBuf[lines++], sizeof(statusBuf[3]), "Phase %d: %s on [%" PRId64 ", %" PRId64 "]", stats.phases, stats.phase, stats.phaseStart, stats.phaseEnd);
+            }
+            for(int line = 0; line < lines; line++) {
+                int statusX = (windowWidth - XTextWidth(font, statusBuf[line], strlen(statusBuf[line]))) / 2;
+                if(statusX < 0) {
+                    statusX = 0;
+                }
+                int statusY = viewportY + viewportHeight + (font->ascent + font->descent + 5) * (line + 1);
+                XDrawString(display, window, gc, statusX, statusY, statusBuf[line], strlen(statusBuf[line]));
             }
-            XDrawString(display, window, gc, statusX, viewportY + viewportHeight + font->ascent + font->descent + 5, statusBuf, strlen(statusBuf));
             XFlush(display);
+            if(firstFrame && exposed) {
+                firstFrame = false;
+                XSync(display, False);
+                fprintf(stderr, "%s: first frame %.1f ms after launch (%s renderer)\n", algoName,
+                    (get_time_usec() - launchUsec) / 1000.0, r->prewarmed ? "prewarmed" : "cold");
+            }
         }
     }
 
-    XFreeGC(display, gc);
-    XFreeGC(display, erase_gc);
-    XFreeFont(display, font);
+    metrics_free(&metrics);
+    free(keys);
+    free(swaps);
+    free(anims);
+    XFreePixmap(display, pixmap);
     XDestroyWindow(display, window);
-    XCloseDisplay(display);
+    XFlush(display);
     if(animation_running) {
         // write a -1 to subprocess to prevent EOF error, if window was closed before sort finished
         // a SIGPIPE may happen if subprocess has finished already, but this process was going to exit right after anyway
-        write_int(algorithm_write_fd, -1);
+        write_varint(algorithm_write_fd, -1);
+        // a child blocked on a full pipe gets EPIPE once these are closed, so it can be reaped
+        close_(algorithm_read_fd);
+        close_(algorithm_write_fd);
+        report_usage(&usage, algorithm_pid, status_fd);
     }
 }
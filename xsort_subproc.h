@@ -1,6 +1,82 @@
 #include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
 
-void run_sort(int64_t *buf, int bufLen, int actionIdx);
+#include "xsort_plugin.h"
+#include "xsort_elem.h"
 
-extern const char * const algo_names[];
-#define ALGO_LEN 6
+// what a run has to achieve: a full sort, only the k-th smallest in its final place (nth_element),
+// or the k smallest sorted at the front (partial_sort)
+enum sort_goal_kind { GOAL_FULL, GOAL_NTH, GOAL_PREFIX };
+struct sort_goal {
+    enum sort_goal_kind kind;
+    int64_t k;
+};
+bool sort_goal_met(const int64_t *buf, int64_t len, struct sort_goal goal);
+
+// the X connection, font and GCs of a sort window, everything that does not depend on the buffer
+// the fork server opens them ahead of time in its renderer pool, prewarmed only changes the latency report
+struct renderer;
+struct renderer *renderer_open(bool prewarmed);
+void renderer_close(struct renderer *r);
+
+// k is only used by the partial sorts, it is clamped to [1, bufLen]
+// buf is converted to the element type with index elemType in elem_types before sorting
+// launchUsec is the get_time_usec of the LAUNCH click, the time to the first frame is printed unless it is 0
+// the resource usage of the run is written to status_fd as a struct run_usage, unless it is -1
+void run_sort(struct renderer *r, int64_t *buf, int64_t bufLen, int actionIdx, int64_t k, int elemType, time_t launchUsec, int status_fd);
+// animates a sort driven by another process speaking the pipe protocol on the given fds
+// algorithm_pid is reaped when the sort ends, SIGCHLD must not be ignored
+void run_sort_fds(struct renderer *r, struct elem_buf *eb, const char *algoName, struct sort_goal goal, int algorithm_read_fd, int algorithm_write_fd, pid_t algorithm_pid, time_t launchUsec, int status_fd);
+
+// the pipe protocol as seen from the algorithm side, for code driving run_sort_fds
+int algo_smaller(int read_fd, int write_fd, int64_t i, int64_t j);
+void algo_swap(int write_fd, int64_t i, int64_t j);
+void algo_finish(int write_fd);
+
+// longest strategy note an algorithm can report, see the Auto algorithm
+#define SORT_NOTE_LEN 128
+struct sort_stats {
+    int64_t comparisons;
+    int64_t swaps;
+    // keys read directly instead of compared, used by sampling and distribution sorts
+    int64_t reads;
+    // number of notes received, and the latest one
+    int notes;
+    char note[SORT_NOTE_LEN];
+    // phase switches of hybrid algorithms, and the latest phase with its inclusive range
+    int phases;
+    char phase[SORT_NOTE_LEN];
+    int64_t phaseStart, phaseEnd;
+    // compare-exchange stages of sorting networks, their comparisons are in comparisons
+    // a stage of more than 4096 pairs arrives in several batches and counts once per batch
+    int64_t stages;
+};
+void run_sort_headless(int64_t *buf, int64_t bufLen, int algoSelection, int64_t k, struct sort_stats *stats);
+
+// one request of an algorithm, in the order it was sent; j equals i for reads
+enum sort_op_kind { SORT_OP_COMPARE, SORT_OP_SWAP, SORT_OP_READ };
+struct sort_op {
+    enum sort_op_kind kind;
+    int64_t i, j;
+};
+struct sort_op_log {
+    struct sort_op *ops;
+    int64_t len, cap;
+};
+// run_sort_headless for any element type, every request is appended to log when it is not NULL
+void run_sort_headless_elems(struct elem_buf *eb, int algoSelection, int64_t k, struct sort_stats *stats, struct sort_op_log *log);
+// the swaps of log as (i, j) pairs; free with free()
+int64_t *sort_op_log_swaps(const struct sort_op_log *log);
+// like run_sort_headless, but also returns the swaps in order as (i, j) pairs, stats->swaps of them; free with free()
+int64_t *run_sort_record(int64_t *buf, int64_t bufLen, int algoSelection, int64_t k, struct sort_stats *stats);
+
+// the algorithm registry: built-in algorithms, then plugins, then "All" as the last selection
+void algo_load_plugins(void);
+int algo_count(void);
+const char *algo_name(int algoSelection);
+// selection of the algorithm with this name, -1 when there is none, never "All"
+int algo_find(const char *name);
+unsigned algo_flags(int algoSelection);
+struct sort_goal algo_goal(int algoSelection, int64_t bufLen, int64_t k);
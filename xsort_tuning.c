@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "xsort_tuning.h"
+
+#define TUNING_DEFAULT_FILE "xsort_tuning.conf"
+
+#define TUNING_DEFAULTS {          \
+    .insertionCutoff = 16,         \
+    .pivotSample = 3,              \
+    .radixBits = 8,                \
+    .blockSize = 16,               \
+    .nativeInsertionCutoff = 24,   \
+    .nativeBlockSize = 64,         \
+}
+
+struct sort_tuning tuning = TUNING_DEFAULTS;
+
+// pdqsort's pattern breaking swaps at a quarter of each side need partitions of at least 8
+static const struct {
+    const char *key;
+    int *value;
+    int min, max;
+} params[] = {
+    { "insertion_cutoff", &tuning.insertionCutoff, 1, 256 },
+    { "pivot_sample", &tuning.pivotSample, 1, 9 },
+    { "radix_bits", &tuning.radixBits, 1, TUNING_MAX_RADIX_BITS },
+    { "block_size", &tuning.blockSize, 1, TUNING_MAX_BLOCK_SIZE },
+    { "native_insertion_cutoff", &tuning.nativeInsertionCutoff, 8, 256 },
+    { "native_block_size", &tuning.nativeBlockSize, 1, TUNING_MAX_BLOCK_SIZE },
+};
+#define PARAMS_LEN ((int)(sizeof(params) / sizeof(params[0])))
+
+const char *tuning_file(void) {
+    const char *path = getenv("XSORT_TUNING_FILE");
+    return path ? path : TUNING_DEFAULT_FILE;
+}
+
+void tuning_load(void) {
+    const char *path = tuning_file();
+    FILE *f = fopen(path, "r");
+    if(!f) {
+        if(errno != ENOENT) {
+            perror(path);
+        }
+        return;
+    }
+    char line[256];
+    int lineNr = 0;
+    while(fgets(line, sizeof(line), f)) {
+        lineNr++;
+        char key[64];
+        int value;
+        if(line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if(sscanf(line, " %63[a-z_] = %d", key, &value) != 2) {
+            fprintf(stderr, "%s:%d: expected \"key = value\"\n", path, lineNr);
+            continue;
+        }
+        int i;
+        for(i = 0; i < PARAMS_LEN && strcmp(params[i].key, key) != 0; i++);
+        if(i == PARAMS_LEN) {
+            fprintf(stderr, "%s:%d: unknown setting \"%s\"\n", path, lineNr, key);
+            continue;
+        }
+        if(value < params[i].min || value > params[i].max) {
+            fprintf(stderr, "%s:%d: %s must be in [%d, %d]\n", path, lineNr, key, params[i].min, params[i].max);
+            continue;
+        }
+        *params[i].value = value;
+    }
+    fclose(f);
+    if(tuning.pivotSample != 1 && tuning.pivotSample != 3 && tuning.pivotSample != 9) {
+        fprintf(stderr, "%s: pivot_sample must be 1, 3 or 9, using 3\n", path);
+        tuning.pivotSample = 3;
+    }
+}
+
+void tuning_reset(void) {
+    tuning = (struct sort_tuning)TUNING_DEFAULTS;
+}
+
+void tuning_print(FILE *out) {
+    for(int i = 0; i < PARAMS_LEN; i++) {
+        fprintf(out, "%s = %d\n", params[i].key, *params[i].value);
+    }
+}
+
+bool tuning_save(const char *path) {
+    FILE *f = fopen(path, "w");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "# written by xsort --tune, read by every sort at startup\n");
+    tuning_print(f);
+    if(fclose(f) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include <stdbool.h>
+
+// thresholds of the hybrid sorts, read once at startup from a config file written by xsort --tune
+struct sort_tuning {
+    // instrumented sorts
+    // partitions of at most this many elements are insertion sorted
+    int insertionCutoff;
+    // elements sampled for a quicksort pivot: 1 (middle), 3 (median of 3) or 9 (ninther)
+    int pivotSample;
+    // digit width of Auto's radix sort
+    int radixBits;
+    // BlockQuicksort block size
+    int blockSize;
+    // native sorts
+    int nativeInsertionCutoff;
+    int nativeBlockSize;
+};
+extern struct sort_tuning tuning;
+
+// largest block sizes, the native offsets are stored in unsigned chars
+#define TUNING_MAX_BLOCK_SIZE 128
+#define TUNING_MAX_RADIX_BITS 16
+
+// $XSORT_TUNING_FILE, or xsort_tuning.conf in the working directory
+const char *tuning_file(void);
+// keeps the defaults when the file does not exist
+void tuning_load(void);
+// back to the built-in defaults, for runs that must not depend on the tuning file
+void tuning_reset(void);
+bool tuning_save(const char *path);
+void tuning_print(FILE *out);
@@ -0,0 +1,88 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "xsort_usage.h"
+
+static void from_rusage(const struct rusage *ru, struct proc_usage *u) {
+    u->cpuSec = ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6 + ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+    // kilobytes on Linux
+    u->peakRssKb = ru->ru_maxrss;
+    u->voluntarySwitches = ru->ru_nvcsw;
+    u->involuntarySwitches = ru->ru_nivcsw;
+    u->minorFaults = ru->ru_minflt;
+    u->majorFaults = ru->ru_majflt;
+}
+
+void usage_self(struct proc_usage *u) {
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) != 0) {
+        perror("getrusage");
+        *u = (struct proc_usage){0};
+        return;
+    }
+    from_rusage(&ru, u);
+}
+
+bool usage_proc(pid_t pid, struct proc_usage *u) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *f = fopen(path, "r");
+    if(!f) {
+        return false;
+    }
+    char line[1024];
+    bool ok = fgets(line, sizeof(line), f) != NULL;
+    fclose(f);
+    // the command name in parentheses may contain spaces, the fields start after the last ')'
+    char *fields = ok ? strrchr(line, ')') : NULL;
+    unsigned long minflt, majflt, utime, stime;
+    if(!fields || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %lu %*u %lu %*u %lu %lu", &minflt, &majflt, &utime, &stime) != 4) {
+        return false;
+    }
+    long ticks = sysconf(_SC_CLK_TCK);
+    *u = (struct proc_usage){
+        .cpuSec = (double)(utime + stime) / (ticks > 0 ? ticks : 100),
+        .minorFaults = minflt,
+        .majorFaults = majflt,
+    };
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    f = fopen(path, "r");
+    if(!f) {
+        return false;
+    }
+    while(fgets(line, sizeof(line), f)) {
+        sscanf(line, "VmHWM: %ld", &u->peakRssKb);
+        sscanf(line, "voluntary_ctxt_switches: %ld", &u->voluntarySwitches);
+        sscanf(line, "nonvoluntary_ctxt_switches: %ld", &u->involuntarySwitches);
+    }
+    fclose(f);
+    return true;
+}
+
+bool usage_wait(pid_t pid, struct proc_usage *u) {
+    struct rusage ru;
+    while(wait4(pid, NULL, 0, &ru) < 0) {
+        if(errno == EINTR) continue;
+        // ECHILD if SIGCHLD is ignored, the child was reaped automatically
+        return false;
+    }
+    from_rusage(&ru, u);
+    return true;
+}
+
+void run_usage_format(const struct run_usage *u, char *str, size_t len) {
+    const struct proc_usage *r = &u->renderer, *a = &u->algorithm;
+    snprintf(str, len, "renderer+algorithm: %.2f+%.2f s CPU, %ld+%ld KB peak RSS, %ld+%ld context switches, %ld+%ld page faults, %" PRIu64 " KB over the pipes",
+        r->cpuSec, a->cpuSec, r->peakRssKb, a->peakRssKb, r->voluntarySwitches + r->involuntarySwitches, a->voluntarySwitches + a->involuntarySwitches,
+        r->minorFaults + r->majorFaults, a->minorFaults + a->majorFaults, u->ipcBytes >> 10);
+}
@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// resources used by one process
+struct proc_usage {
+    // user + system
+    double cpuSec;
+    long peakRssKb;
+    long voluntarySwitches, involuntarySwitches;
+    long minorFaults, majorFaults;
+};
+
+// what a renderer reports to the fork server over the status channel, one atomic pipe write
+struct run_usage {
+    char algoName[64];
+    struct proc_usage renderer;
+    struct proc_usage algorithm;
+    // bytes the renderer read from and wrote to the algorithm pipes
+    uint64_t ipcBytes;
+};
+
+// getrusage for the calling process
+void usage_self(struct proc_usage *u);
+// /proc numbers of a child that is still running, false when it is gone
+bool usage_proc(pid_t pid, struct proc_usage *u);
+// reaps an exited child and returns its final numbers, false when it was already reaped
+bool usage_wait(pid_t pid, struct proc_usage *u);
+// renderer+algorithm pairs of every number, for the status pane and stderr
+void run_usage_format(const struct run_usage *u, char *str, size_t len);